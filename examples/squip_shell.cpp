@@ -1,6 +1,5 @@
 #include <cstring>
 #include <filesystem>
-#include <fstream>
 #include <iostream>
 #include <stdexcept>
 #include <string>
@@ -64,6 +63,35 @@ Options parse_args(int argc, char** argv)
   return opts;
 }
 
+class Position
+{
+public:
+  Position() :
+    m_name("Hello World")
+  {}
+
+  void print(HSQUIRRELVM vm) const
+  {
+    SQInteger x = 333;
+    SQInteger y = 666;
+
+    sq_pushstring(vm, "x", -1);
+    sq_get(vm, 1);
+    sq_getinteger(vm, -1, &x);
+
+    sq_pushstring(vm, "y", -1);
+    sq_get(vm, 1);
+    sq_getinteger(vm, -1, &y);
+
+    sq_pop(vm, 2);
+
+    fmt::print("Position: {} - {}, {}\n", m_name, x, y);
+  }
+
+private:
+  std::string m_name;
+};
+
 void register_functions(squip::TableContext& tbl)
 {
   tbl.store_c_function("doit", ". i|f|b i|f|b i|f|b", [](HSQUIRRELVM vm) -> SQInteger {
@@ -105,11 +133,9 @@ void register_functions(squip::TableContext& tbl)
     return SQ_OK;
   });
 
-  tbl.store_function("make_position", ".nn", [](HSQUIRRELVM vm) -> SQInteger {
-    auto [x, y] = squip::unpack_args<float, float>(vm);
+  tbl.store_function("make_position", squip::bind([](float x, float y) {
     fmt::print("make_position: {}, {}\n", x, y);
-    return SQ_OK;
-  });
+  }));
 
   tbl.store_c_function("myprintln", nullptr, [](HSQUIRRELVM vm) -> SQInteger {
     SQInteger const nargs = sq_gettop(vm);
@@ -226,114 +252,30 @@ int main(int argc, char** argv) try
     HSQUIRRELVM vm = sqvm.get_vm();
     sq_pushroottable(vm);
 
-    sq_newclass(vm, 0);
+    squip::ClassBinding<Position> position_class = squip::new_class<Position>(vm);
+    position_class.store("x", 11);
+    position_class.store("y", 22);
+    position_class.method<&Position::print>("print");
 
     sq_pushstring(vm, "Position", -1);
     sq_push(vm, 2);
     sq_newslot(vm, 1, false);
 
-    sq_pushstring(vm, "x", -1);
-    sq_pushinteger(vm, 11);
-    sq_newslot(vm, 2, false);
-
-    sq_pushstring(vm, "y", -1);
-    sq_pushinteger(vm, 22);
-    sq_newslot(vm, 2, false);
-
-    sq_pushstring(vm, "constructor", -1);
-    sq_newclosure(vm, [](HSQUIRRELVM lvm) -> SQRESULT {
-      sq_setinstanceup(lvm, 1, new std::string("Hello World"));
-
-      // set x
-      sq_pushstring(lvm, "x", -1);
-      sq_pushinteger(lvm, 111);
-      if (SQ_FAILED(sq_set(lvm, 1))) {
-        throw squip::SquirrelError::from_vm(lvm, "failed to set");
-      }
-
-      // print
-      sq_pushstring(lvm, "print", -1);
-      if (SQ_FAILED(sq_get(lvm, 1))) {
-        throw squip::SquirrelError::from_vm(lvm, "failed to get print()");
-      }
-      sq_push(lvm, 1);
-      sq_call(lvm, 1, SQFalse, SQFalse);
-      sq_poptop(lvm);
-
-      // set y
-      sq_pushstring(lvm, "y", -1);
-      sq_pushinteger(lvm, 222);
-      sq_set(lvm, 1);
-
-      return SQ_OK;
-    }, 0);
-    sq_newslot(vm, 2, false);
-
-    sq_setreleasehook(vm, 2, [](SQUserPointer userptr, SQInteger size) -> SQInteger {
-      std::string* stringptr = static_cast<std::string*>(userptr);
-      delete stringptr;
-      return 1;
-    });
-
-    sq_pushstring(vm, "print", -1);
-    sq_newclosure(vm, [](HSQUIRRELVM lvm) -> SQRESULT {
-      SQInteger x = 333;
-      SQInteger y = 666;
-
-      SQUserPointer userptr;
-      sq_getinstanceup(lvm, 1, &userptr, nullptr, SQFalse);
-
-      sq_pushstring(lvm, "x", -1);
-      sq_get(lvm, 1);
-      sq_getinteger(lvm, -1, &x);
-
-      sq_pushstring(lvm, "y", -1);
-      sq_get(lvm, 1);
-      sq_getinteger(lvm, -1, &y);
-
-      fmt::print("Position: {} - {}, {}\n",
-                 *static_cast<std::string*>(userptr),
-                 x, y);
-      return SQ_OK;
-    }, 0);
-    sq_newslot(vm, 2, false);
-
-    {
-      HSQMEMBERHANDLE x_memberhandle;
-      sq_pushstring(vm, "x", -1);
-      if (SQ_FAILED(sq_getmemberhandle(vm, 2, &x_memberhandle))) {
-        throw squip::SquirrelError::from_vm(vm, "failed to get member handle");
-      }
-
-      SQInteger x;
-      if (SQ_FAILED(sq_getbyhandle(vm, 2, &x_memberhandle))) {
-        throw squip::SquirrelError::from_vm(vm, "failed to get by member handle");
-      }
-
-      if (SQ_FAILED(sq_getinteger(vm, -1, &x))) {
-        throw squip::SquirrelError::from_vm(vm, "failed to get integer");
-      }
-
-      fmt::print("x from member handle: {}\n", x);
-      sq_poptop(vm);
-    }
+    squip::FieldRef const x_field = position_class.field("x");
+    fmt::print("x from member handle: {}\n", x_field.get<SQInteger>(vm, 2));
 
     sq_pop(vm, 2);
     assert(sq_gettop(vm) == 0);
   }
 
+  squip::EvalCache eval_cache(sqvm);
   for (auto const& code : opts.code){
     if (std::holds_alternative<std::filesystem::path>(code)) {
       std::filesystem::path const& filename = std::get<std::filesystem::path>(code);
-      std::ifstream fin(filename);
-      if (!fin) {
-        throw std::runtime_error(fmt::format("failed to load: {}", filename.string()));
-      }
-      squip::compile_and_run(sqvm.get_vm(), fin, filename);
+      squip::compile_and_run_file(sqvm.get_vm(), filename);
     } else {
       std::string const& text = std::get<std::string>(code);
-      std::istringstream is(text);
-      squip::compile_and_run(sqvm.get_vm(), is, "<source>");
+      eval_cache.compile_and_run(sqvm.get_vm(), text, "<source>");
     }
   }
 
@@ -0,0 +1,257 @@
+// squip - Utilities for Squirrel
+// Copyright (C) 2023 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef HEADER_SQUIP_BIND_HPP
+#define HEADER_SQUIP_BIND_HPP
+
+#include <array>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <squirrel.h>
+
+#include "squip/unpack.hpp"
+#include "squip/util.hpp"
+
+namespace squip {
+
+namespace detail {
+
+template<typename F>
+struct function_signature : function_signature<decltype(&F::operator())> {};
+
+template<typename R, typename... Args>
+struct function_signature<R (*)(Args...)>
+{
+  using result_type = R;
+  using args_type = std::tuple<Args...>;
+};
+
+template<typename R, typename... Args>
+struct function_signature<R (*)(Args...) noexcept> : function_signature<R (*)(Args...)> {};
+
+template<typename C, typename R, typename... Args>
+struct function_signature<R (C::*)(Args...)> : function_signature<R (*)(Args...)> {};
+
+template<typename C, typename R, typename... Args>
+struct function_signature<R (C::*)(Args...) noexcept> : function_signature<R (*)(Args...)> {};
+
+template<typename C, typename R, typename... Args>
+struct function_signature<R (C::*)(Args...) const> : function_signature<R (*)(Args...)> {};
+
+template<typename C, typename R, typename... Args>
+struct function_signature<R (C::*)(Args...) const noexcept> : function_signature<R (*)(Args...)> {};
+
+template<typename T>
+struct is_vector : std::false_type {};
+
+template<typename T>
+struct is_vector<std::vector<T>> : std::true_type {};
+
+template<typename T>
+constexpr char typemask_char()
+{
+  using U = std::remove_cvref_t<T>;
+  if constexpr (std::is_same_v<U, bool>) {
+    return 'b';
+  } else if constexpr (std::is_arithmetic_v<U>) {
+    return 'n';
+  } else if constexpr (std::is_same_v<U, std::string> ||
+                       std::is_same_v<U, std::string_view> ||
+                       std::is_same_v<U, SQChar const*>) {
+    return 's';
+  } else if constexpr (std::is_same_v<U, SQUserPointer>) {
+    return 'p';
+  } else if constexpr (is_vector<U>::value) {
+    return 'a';
+  } else {
+    return '.';
+  }
+}
+
+/** Typemask with a leading This for 'this' and a trailing '\0' */
+template<SQChar This, typename... Args>
+inline constexpr std::array<SQChar, sizeof...(Args) + 2> typemask_v = { This, typemask_char<Args>()..., '\0' };
+
+template<typename T>
+std::remove_cvref_t<T> unpack_arg(HSQUIRRELVM vm, SQInteger idx)
+{
+  using U = std::remove_cvref_t<T>;
+  if constexpr (std::is_same_v<U, bool>) {
+    return unpack<bool>(vm, idx);
+  } else if constexpr (std::is_floating_point_v<U>) {
+    return static_cast<U>(unpack<SQFloat>(vm, idx));
+  } else if constexpr (std::is_integral_v<U>) {
+    return static_cast<U>(unpack<SQInteger>(vm, idx));
+  } else {
+    return unpack<U>(vm, idx);
+  }
+}
+
+/** Non-throwing variant of unpack_arg() */
+template<typename T>
+std::optional<std::remove_cvref_t<T>> try_unpack_arg(HSQUIRRELVM vm, SQInteger idx)
+{
+  using U = std::remove_cvref_t<T>;
+  if constexpr (std::is_same_v<U, bool>) {
+    return try_unpack<bool>(vm, idx);
+  } else if constexpr (std::is_floating_point_v<U>) {
+    if (std::optional<SQFloat> value = try_unpack<SQFloat>(vm, idx)) {
+      return static_cast<U>(*value);
+    }
+    return std::nullopt;
+  } else if constexpr (std::is_integral_v<U>) {
+    if (std::optional<SQInteger> value = try_unpack<SQInteger>(vm, idx)) {
+      return static_cast<U>(*value);
+    }
+    return std::nullopt;
+  } else {
+    return try_unpack<U>(vm, idx);
+  }
+}
+
+template<typename T>
+void push_result(HSQUIRRELVM vm, T&& value)
+{
+  using U = std::remove_cvref_t<T>;
+  if constexpr (std::is_same_v<U, bool>) {
+    sq_pushbool(vm, value ? SQTrue : SQFalse);
+  } else if constexpr (std::is_floating_point_v<U>) {
+    sq_pushfloat(vm, static_cast<SQFloat>(value));
+  } else if constexpr (std::is_integral_v<U>) {
+    sq_pushinteger(vm, static_cast<SQInteger>(value));
+  } else {
+    push_value(vm, std::forward<T>(value));
+  }
+}
+
+template<auto Func>
+struct FunctionInvoker
+{
+  template<typename... Args>
+  decltype(auto) operator()(Args&&... args) const {
+    return std::invoke(Func, std::forward<Args>(args)...);
+  }
+};
+
+/** Functions taking HSQUIRRELVM as first parameter get the calling
+    VM, the remaining parameters are the script arguments */
+template<typename ArgsTuple>
+struct script_args
+{
+  static constexpr bool passes_vm = false;
+  using type = ArgsTuple;
+};
+
+template<typename... Args>
+struct script_args<std::tuple<HSQUIRRELVM, Args...>>
+{
+  static constexpr bool passes_vm = true;
+  using type = std::tuple<Args...>;
+};
+
+/** Call func, push its result and return the number of values pushed,
+    exceptions are turned into Squirrel errors */
+template<typename R, typename F>
+SQInteger call_and_push(HSQUIRRELVM vm, F&& func)
+{
+  try {
+    if constexpr (std::is_void_v<R>) {
+      func();
+      return 0;
+    } else {
+      push_result(vm, func());
+      return 1;
+    }
+  } catch (std::exception const& err) {
+    return sq_throwerror(vm, err.what());
+  }
+}
+
+template<typename Invoker, typename R, bool PassesVM, typename ArgsTuple>
+struct Trampoline;
+
+template<typename Invoker, typename R, bool PassesVM, typename... Args>
+struct Trampoline<Invoker, R, PassesVM, std::tuple<Args...>>
+{
+  static constexpr auto const& typemask = typemask_v<'.', Args...>;
+
+  template<size_t... Is>
+  static decltype(auto) invoke([[maybe_unused]] HSQUIRRELVM vm, std::index_sequence<Is...>) {
+    if constexpr (PassesVM) {
+      return Invoker{}(vm, unpack_arg<Args>(vm, static_cast<SQInteger>(2 + Is))...);
+    } else {
+      return Invoker{}(unpack_arg<Args>(vm, static_cast<SQInteger>(2 + Is))...);
+    }
+  }
+
+  static SQInteger call(HSQUIRRELVM vm)
+  {
+    return call_and_push<R>(vm, [vm]() -> decltype(auto) {
+      return invoke(vm, std::index_sequence_for<Args...>{});
+    });
+  }
+};
+
+template<typename Invoker, typename Signature>
+constexpr NativeFunction make_native_function()
+{
+  using Args = script_args<typename Signature::args_type>;
+  using T = Trampoline<Invoker,
+                       typename Signature::result_type,
+                       Args::passes_vm,
+                       typename Args::type>;
+  return NativeFunction{&T::call, T::typemask.data()};
+}
+
+} // namespace detail
+
+/** Generate a SQFUNCTION trampoline for a free function at compile
+    time. Arguments are unpacked and the return value is pushed
+    automatically, the typemask is derived from the parameter types.
+    A leading HSQUIRRELVM parameter receives the calling VM.
+
+    squip::bind<&myfunc>() */
+template<auto Func>
+constexpr NativeFunction bind()
+{
+  return detail::make_native_function<detail::FunctionInvoker<Func>,
+                                      detail::function_signature<decltype(Func)>>();
+}
+
+/** Like bind<&func>(), but for stateless callables such as lambdas
+    without captures. Callables with state have to go through
+    push_function() or push_closure(). */
+template<typename F>
+constexpr NativeFunction bind(F const&)
+{
+  static_assert(std::is_empty_v<F> && std::is_default_constructible_v<F>,
+                "squip::bind() requires a stateless callable");
+  return detail::make_native_function<F, detail::function_signature<F>>();
+}
+
+} // namespace squip
+
+#endif
+
+/* EOF */
@@ -0,0 +1,115 @@
+// squip - Utilities for Squirrel
+// Copyright (C) 2023 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef HEADER_SQUIP_BUNDLE_HPP
+#define HEADER_SQUIP_BUNDLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <squirrel.h>
+
+#include "squip/mapped_file.hpp"
+#include "squip/object.hpp"
+
+namespace squip {
+
+/** A single file holding many precompiled closures along with a
+    sorted name index. The file is mmap'd and closures are only
+    deserialized the first time they are requested.
+
+    Deserialized closures are cached, so a Bundle must only be used
+    with a single SquirrelVM (and its threads) and must be destroyed
+    before that VM. */
+class Bundle
+{
+public:
+  Bundle(std::filesystem::path const& path);
+  ~Bundle();
+
+  size_t size() const { return m_count; }
+  bool contains(std::string_view name) const;
+  std::vector<std::string_view> get_names() const;
+
+  /** Push the closure stored under name on the stack */
+  void push_closure(HSQUIRRELVM vm, std::string_view name);
+
+private:
+  friend class BundleWriter;
+
+  struct IndexEntry
+  {
+    uint64_t name_offset;
+    uint64_t name_size;
+    uint64_t data_offset;
+    uint64_t data_size;
+  };
+
+  IndexEntry get_entry(size_t idx) const;
+  std::string_view get_name(IndexEntry const& entry) const;
+  std::optional<size_t> find(std::string_view name) const;
+
+private:
+  std::filesystem::path m_path;
+  MappedFile m_file;
+  size_t m_count;
+  size_t m_index_offset;
+  std::vector<Object> m_closures;
+
+public:
+  Bundle(Bundle const&) = delete;
+  Bundle& operator=(Bundle const&) = delete;
+};
+
+/** Collects precompiled closures and writes them out as a Bundle */
+class BundleWriter
+{
+public:
+  BundleWriter();
+  ~BundleWriter();
+
+  /** Add the closure on top of the stack under name, the closure
+      stays on the stack. An existing entry of the same name is
+      replaced. */
+  void add_closure(HSQUIRRELVM vm, std::string_view name);
+
+  /** Add bytecode produced by write_closure() under name */
+  void add_bytecode(std::string_view name, std::vector<std::byte> bytecode);
+
+  void write(std::filesystem::path const& path) const;
+
+  size_t size() const { return m_entries.size(); }
+
+private:
+  std::map<std::string, std::vector<std::byte>, std::less<>> m_entries;
+
+public:
+  BundleWriter(BundleWriter const&) = delete;
+  BundleWriter& operator=(BundleWriter const&) = delete;
+};
+
+} // namespace squip
+
+#endif
+
+/* EOF */
@@ -0,0 +1,264 @@
+// squip - Utilities for Squirrel
+// Copyright (C) 2023 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef HEADER_SQUIP_CLASS_BINDING_HPP
+#define HEADER_SQUIP_CLASS_BINDING_HPP
+
+#include <exception>
+#include <functional>
+#include <new>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include <squirrel.h>
+
+#include "squip/bind.hpp"
+#include "squip/field_ref.hpp"
+#include "squip/squirrel_error.hpp"
+#include "squip/util.hpp"
+
+namespace squip {
+
+/**
+   Binds the C++ type T to the Squirrel class at idx. Instances store
+   their T inline in the instance's userdata (sq_setclassudsize()), it
+   is constructed by the bound constructor and destroyed from the
+   instance's release hook, so no allocation beyond the instance
+   itself is needed. Methods are called through typed trampolines
+   generated at compile time, as with squip::bind().
+
+   squip::ClassBinding<Position> cls = squip::new_class<Position>(vm);
+   cls.constructor<std::string>();
+   cls.method<&Position::get_name>("get_name");
+*/
+template<typename T>
+class ClassBinding
+{
+  static_assert(alignof(T) <= alignof(SQInteger),
+                "ClassBinding can't store over-aligned types in instances");
+
+public:
+  ClassBinding(HSQUIRRELVM vm, SQInteger idx) :
+    m_vm(vm),
+    m_idx(absolute_index(vm, idx))
+  {
+    if (SQ_FAILED(sq_setclassudsize(m_vm, m_idx, sizeof(T)))) {
+      throw SquirrelError::from_vm(m_vm, "failed to set class userdata size");
+    }
+
+    if (SQ_FAILED(sq_settypetag(m_vm, m_idx, typetag()))) {
+      throw SquirrelError::from_vm(m_vm, "failed to set class typetag");
+    }
+
+    if constexpr (std::is_default_constructible_v<T>) {
+      constructor<>();
+    }
+  }
+
+  /** Bind a constructor calling T(Args...), replaces the default
+      constructor bound for default constructible types */
+  template<typename... Args>
+  void constructor()
+  {
+    using C = Constructor<std::tuple<Args...>>;
+    store_native("constructor", &C::call, C::typemask.data());
+  }
+
+  /** Bind the member function Method, a leading HSQUIRRELVM parameter
+      receives the calling VM */
+  template<auto Method>
+  void method(std::string_view name)
+  {
+    using Signature = detail::function_signature<decltype(Method)>;
+    using Args = detail::script_args<typename Signature::args_type>;
+    using M = MethodTrampoline<Method,
+                               typename Signature::result_type,
+                               Args::passes_vm,
+                               typename Args::type>;
+    store_native(name, &M::call, M::typemask.data());
+  }
+
+  /** Bind a plain native function as method, for signatures the typed
+      trampolines can't express. get_instance(vm, 1) gives access to
+      'this'. */
+  void method(std::string_view name, SQFUNCTION func, SQChar const* typemask)
+  {
+    store_native(name, func, typemask);
+  }
+
+  /** Store a class member, e.g. a default value for instances */
+  template<typename V>
+  void store(std::string_view name, V&& value)
+  {
+    sq_pushstring(m_vm, name.data(), static_cast<SQInteger>(name.size()));
+    push_value(m_vm, std::forward<V>(value));
+    if (SQ_FAILED(sq_newslot(m_vm, m_idx, SQFalse))) {
+      throw SquirrelError::from_vm(m_vm, "failed to store class member");
+    }
+  }
+
+  /** Resolve a member previously stored in the class for fast
+      access on instances */
+  FieldRef field(std::string_view name) const
+  {
+    return FieldRef(m_vm, m_idx, name);
+  }
+
+  HSQOBJECT get_handle() const
+  {
+    HSQOBJECT obj;
+    sq_resetobject(&obj);
+    if (SQ_FAILED(sq_getstackobj(m_vm, m_idx, &obj))) {
+      throw SquirrelError::from_vm(m_vm, "failed to get class object");
+    }
+    return obj;
+  }
+
+  /** Return the T of the instance at idx or nullptr when idx is not a
+      constructed instance of this class or a class derived from it */
+  static T* get_instance(HSQUIRRELVM vm, SQInteger idx)
+  {
+    SQUserPointer userptr;
+    if (SQ_FAILED(sq_getinstanceup(vm, idx, &userptr, typetag(), SQFalse))) {
+      return nullptr;
+    }
+
+    // the release hook is only installed once T got constructed
+    if (sq_getreleasehook(vm, idx) != &release_hook) {
+      return nullptr;
+    }
+
+    return std::launder(static_cast<T*>(userptr));
+  }
+
+  static SQUserPointer typetag()
+  {
+    static char tag = 0;
+    return &tag;
+  }
+
+private:
+  static SQInteger release_hook(SQUserPointer userptr, SQInteger /*size*/)
+  {
+    std::launder(static_cast<T*>(userptr))->~T();
+    return 1;
+  }
+
+  template<typename ArgsTuple>
+  struct Constructor;
+
+  template<typename... Args>
+  struct Constructor<std::tuple<Args...>>
+  {
+    static constexpr auto const& typemask = detail::typemask_v<'x', Args...>;
+
+    template<size_t... Is>
+    static void construct([[maybe_unused]] HSQUIRRELVM vm, SQUserPointer userptr, std::index_sequence<Is...>) {
+      new(userptr) T(detail::unpack_arg<Args>(vm, static_cast<SQInteger>(2 + Is))...);
+    }
+
+    static SQInteger call(HSQUIRRELVM vm)
+    {
+      SQUserPointer userptr;
+      if (SQ_FAILED(sq_getinstanceup(vm, 1, &userptr, typetag(), SQFalse))) {
+        return sq_throwerror(vm, "invalid instance");
+      }
+
+      try {
+        // constructor called a second time
+        if (T* self = get_instance(vm, 1)) {
+          sq_setreleasehook(vm, 1, nullptr);
+          self->~T();
+        }
+
+        construct(vm, userptr, std::index_sequence_for<Args...>{});
+        sq_setreleasehook(vm, 1, &release_hook);
+        return 0;
+      } catch (std::exception const& err) {
+        return sq_throwerror(vm, err.what());
+      }
+    }
+  };
+
+  template<auto Method, typename R, bool PassesVM, typename ArgsTuple>
+  struct MethodTrampoline;
+
+  template<auto Method, typename R, bool PassesVM, typename... Args>
+  struct MethodTrampoline<Method, R, PassesVM, std::tuple<Args...>>
+  {
+    static constexpr auto const& typemask = detail::typemask_v<'x', Args...>;
+
+    template<size_t... Is>
+    static decltype(auto) invoke([[maybe_unused]] HSQUIRRELVM vm, T& self, std::index_sequence<Is...>) {
+      if constexpr (PassesVM) {
+        return std::invoke(Method, self, vm, detail::unpack_arg<Args>(vm, static_cast<SQInteger>(2 + Is))...);
+      } else {
+        return std::invoke(Method, self, detail::unpack_arg<Args>(vm, static_cast<SQInteger>(2 + Is))...);
+      }
+    }
+
+    static SQInteger call(HSQUIRRELVM vm)
+    {
+      T* const self = get_instance(vm, 1);
+      if (self == nullptr) {
+        return sq_throwerror(vm, "invalid instance, constructor not called");
+      }
+
+      return detail::call_and_push<R>(vm, [vm, self]() -> decltype(auto) {
+        return invoke(vm, *self, std::index_sequence_for<Args...>{});
+      });
+    }
+  };
+
+  void store_native(std::string_view name, SQFUNCTION func, SQChar const* typemask)
+  {
+    sq_pushstring(m_vm, name.data(), static_cast<SQInteger>(name.size()));
+    sq_newclosure(m_vm, func, 0);
+    sq_setnativeclosurename(m_vm, -1, std::string(name).c_str());
+    sq_setparamscheck(m_vm, SQ_MATCHTYPEMASKSTRING, typemask);
+
+    if (SQ_FAILED(sq_newslot(m_vm, m_idx, SQFalse))) {
+      throw SquirrelError::from_vm(m_vm, "failed to register method");
+    }
+  }
+
+private:
+  HSQUIRRELVM m_vm;
+  SQInteger m_idx;
+
+public:
+  ClassBinding(ClassBinding const&) = delete;
+  ClassBinding& operator=(ClassBinding const&) = delete;
+};
+
+/** Create a new class for T and leave it on the stack */
+template<typename T>
+ClassBinding<T> new_class(HSQUIRRELVM vm)
+{
+  if (SQ_FAILED(sq_newclass(vm, SQFalse))) {
+    throw SquirrelError::from_vm(vm, "failed to create class");
+  }
+  return ClassBinding<T>(vm, -1);
+}
+
+} // namespace squip
+
+#endif
+
+/* EOF */
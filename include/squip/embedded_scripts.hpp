@@ -0,0 +1,58 @@
+// squip - Utilities for Squirrel
+// Copyright (C) 2023 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef HEADER_SQUIP_EMBEDDED_SCRIPTS_HPP
+#define HEADER_SQUIP_EMBEDDED_SCRIPTS_HPP
+
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include <squirrel.h>
+
+namespace squip {
+
+/** Register precompiled bytecode under name. Neither name nor
+    bytecode are copied, both must have static storage duration. This
+    is normally called from the code generated by the
+    squip_embed_scripts() CMake function. */
+void register_embedded_script(std::string_view name, std::span<std::byte const> bytecode);
+
+/** Return the bytecode registered under name */
+std::optional<std::span<std::byte const>> find_embedded_script(std::string_view name);
+
+/** Return the names of all registered scripts in sorted order */
+std::vector<std::string_view> get_embedded_script_names();
+
+/** Deserialize the embedded script name and push the closure on the stack */
+void push_embedded_script(HSQUIRRELVM vm, std::string_view name);
+
+/** Helper for static registration from generated code */
+class EmbeddedScript
+{
+public:
+  EmbeddedScript(std::string_view name, std::span<unsigned char const> bytecode) {
+    register_embedded_script(name, std::as_bytes(bytecode));
+  }
+};
+
+} // namespace squip
+
+#endif
+
+/* EOF */
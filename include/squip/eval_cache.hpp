@@ -0,0 +1,90 @@
+// squip - Utilities for Squirrel
+// Copyright (C) 2023 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef HEADER_SQUIP_EVAL_CACHE_HPP
+#define HEADER_SQUIP_EVAL_CACHE_HPP
+
+#include <cstdint>
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include <squirrel.h>
+
+#include "squip/fwd.hpp"
+
+namespace squip {
+
+/** LRU cache of closures compiled from short, frequently repeated
+    snippets of source code, such as config expressions or console
+    commands. The cache holds references through the root VM and must
+    be destroyed before the SquirrelVM. */
+class EvalCache
+{
+public:
+  EvalCache(SquirrelVM& sqvm, size_t capacity = 256);
+  ~EvalCache();
+
+  /** Like squip::compile_buffer(), leaves the closure on the stack */
+  void compile_buffer(HSQUIRRELVM vm, std::string_view source,
+                      const std::string& sourcename);
+
+  /** Like squip::compile_and_run() */
+  void compile_and_run(HSQUIRRELVM vm, std::string_view source,
+                       const std::string& sourcename);
+
+  void clear();
+
+  size_t size() const { return m_entries.size(); }
+  size_t get_capacity() const { return m_capacity; }
+
+  uint64_t get_hits() const { return m_hits; }
+  uint64_t get_misses() const { return m_misses; }
+
+private:
+  struct Entry
+  {
+    std::string source;
+    std::string sourcename;
+    HSQOBJECT closure;
+  };
+
+  void evict(std::list<Entry>::iterator it);
+
+private:
+  SquirrelVM& m_sqvm;
+  size_t m_capacity;
+
+  /** most recently used entry first */
+  std::list<Entry> m_entries;
+
+  /** keys point into Entry::source */
+  std::unordered_map<std::string_view, std::list<Entry>::iterator> m_index;
+
+  uint64_t m_hits;
+  uint64_t m_misses;
+
+public:
+  EvalCache(EvalCache const&) = delete;
+  EvalCache& operator=(EvalCache const&) = delete;
+};
+
+} // namespace squip
+
+#endif
+
+/* EOF */
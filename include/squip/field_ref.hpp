@@ -0,0 +1,92 @@
+// squip - Utilities for Squirrel
+// Copyright (C) 2023 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef HEADER_SQUIP_FIELD_REF_HPP
+#define HEADER_SQUIP_FIELD_REF_HPP
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <fmt/format.h>
+#include <squirrel.h>
+
+#include "squip/object.hpp"
+#include "squip/squirrel_error.hpp"
+#include "squip/unpack.hpp"
+#include "squip/util.hpp"
+
+namespace squip {
+
+/** Member of a class resolved once to a member handle, so that reads
+    and writes on instances are an index access instead of a string
+    keyed lookup. The FieldRef is valid for the class it was resolved
+    from, its instances and instances of derived classes, using it on
+    anything else throws SquirrelError. It keeps a reference to the
+    class and must not outlive the VM. */
+class FieldRef
+{
+public:
+  /** Resolve the member name of the class at idx */
+  FieldRef(HSQUIRRELVM vm, SQInteger idx, std::string_view name);
+
+  /** Push the member of the instance at idx */
+  void push(HSQUIRRELVM vm, SQInteger idx) const;
+
+  /** Pop the value on top of the stack and store it in the member of
+      the instance at idx */
+  void pop(HSQUIRRELVM vm, SQInteger idx) const;
+
+  template<typename T>
+  T get(HSQUIRRELVM vm, SQInteger idx) const
+  {
+    push(vm, idx);
+    std::optional<T> result = squip::try_unpack<T>(vm, -1);
+    sq_poptop(vm);
+    if (!result) {
+      throw SquirrelError::from_vm(vm, fmt::format("failed to retrieve member '{}'", m_name));
+    }
+    return std::move(*result);
+  }
+
+  template<typename T>
+  void set(HSQUIRRELVM vm, SQInteger idx, T&& value) const
+  {
+    idx = absolute_index(vm, idx);
+    push_value(vm, std::forward<T>(value));
+    pop(vm, idx);
+  }
+
+  std::string const& get_name() const { return m_name; }
+
+private:
+  /** Throw unless the object at idx is the class the handle was
+      resolved from, a class derived from it or an instance of either,
+      member handles are plain indices that Squirrel doesn't check */
+  void check_class(HSQUIRRELVM vm, SQInteger idx) const;
+
+private:
+  std::string m_name;
+  HSQMEMBERHANDLE m_handle;
+  Object m_class;
+};
+
+} // namespace squip
+
+#endif
+
+/* EOF */
@@ -0,0 +1,204 @@
+// squip - Utilities for Squirrel
+// Copyright (C) 2023 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef HEADER_SQUIP_FIELDS_HPP
+#define HEADER_SQUIP_FIELDS_HPP
+
+#include <array>
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <tuple>
+#include <utility>
+
+#include <fmt/format.h>
+#include <squirrel.h>
+
+#include "squip/bind.hpp"
+#include "squip/key.hpp"
+#include "squip/squirrel_error.hpp"
+#include "squip/squirrel_vm.hpp"
+#include "squip/unpack.hpp"
+#include "squip/util.hpp"
+
+namespace squip {
+
+/** Name and member pointer of a single aggregate field */
+template<typename T, typename M>
+struct Field
+{
+  std::string_view name;
+  M T::* member;
+};
+
+template<typename T, typename M>
+constexpr Field<T, M> field(std::string_view name, M T::* member)
+{
+  return Field<T, M>{name, member};
+}
+
+/* Aggregates are made available to push_value() and unpack() by
+   specializing squip::fields<T> with a tuple of field descriptors:
+
+   template<>
+   struct squip::fields<Vec2>
+   {
+     static constexpr auto value = std::make_tuple(squip::field("x", &Vec2::x),
+                                                   squip::field("y", &Vec2::y));
+   };
+*/
+
+namespace detail {
+
+template<typename T>
+constexpr size_t field_count_v = std::tuple_size_v<std::remove_cvref_t<decltype(fields<T>::value)>>;
+
+template<typename T>
+constexpr std::array<std::string_view, field_count_v<T>> field_names_v =
+  std::apply([](auto const&... field) {
+    return std::array<std::string_view, field_count_v<T>>{field.name...};
+  }, fields<T>::value);
+
+/** Keys for the fields of T interned in vm, empty when vm isn't owned
+    by a SquirrelVM, in which case the names are pushed as strings */
+template<typename T>
+std::span<Key const> field_keys(HSQUIRRELVM vm)
+{
+  static size_t const slot = SquirrelVM::allocate_key_slot();
+
+  SquirrelVM* const sqvm = SquirrelVM::from_vm(vm);
+  if (sqvm == nullptr) {
+    return {};
+  }
+  return sqvm->get_interned_keys(slot, field_names_v<T>);
+}
+
+inline
+void push_field_key(HSQUIRRELVM vm, std::span<Key const> keys, size_t i, std::string_view name)
+{
+  if (keys.empty()) {
+    sq_pushstring(vm, name.data(), static_cast<SQInteger>(name.size()));
+  } else {
+    keys[i].push(vm);
+  }
+}
+
+} // namespace detail
+
+template<Reflectable T>
+void push_value(HSQUIRRELVM vm, T const& value)
+{
+  std::span<Key const> const keys = detail::field_keys<T>(vm);
+
+  // a failed sq_newslot() or a throwing nested push leaves key, value
+  // or the table behind, so restore the whole stack on error
+  SQInteger const oldtop = sq_gettop(vm);
+  try {
+    sq_newtableex(vm, static_cast<SQInteger>(detail::field_count_v<T>));
+    size_t i = 0;
+    std::apply([&](auto const&... field) {
+      ([&] {
+        detail::push_field_key(vm, keys, i, field.name);
+        detail::push_result(vm, value.*(field.member));
+        if (SQ_FAILED(sq_newslot(vm, -3, SQFalse))) {
+          throw SquirrelError::from_vm(vm, fmt::format("failed to store '{}' field", field.name));
+        }
+        i += 1;
+      }(), ...);
+    }, fields<T>::value);
+  } catch (...) {
+    sq_settop(vm, oldtop);
+    throw;
+  }
+}
+
+namespace detail {
+
+/** Fill result from the table at idx, returns the name of the first
+    field that is missing or can't be converted, std::nullopt when all
+    fields were retrieved */
+template<Reflectable T>
+std::optional<std::string_view> unpack_fields(HSQUIRRELVM vm, SQInteger idx, T& result)
+{
+  std::span<Key const> const keys = field_keys<T>(vm);
+
+  std::optional<std::string_view> failed_field;
+  size_t i = 0;
+  std::apply([&](auto const&... field) {
+    // stops at the first failure as && short-circuits
+    (... && [&] {
+      using Member = std::remove_cvref_t<decltype(result.*(field.member))>;
+
+      push_field_key(vm, keys, i, field.name);
+      i += 1;
+      if (SQ_FAILED(sq_get(vm, idx))) {
+        failed_field = field.name;
+        return false;
+      }
+      std::optional<Member> value = try_unpack_arg<Member>(vm, -1);
+      sq_poptop(vm);
+      if (!value) {
+        failed_field = field.name;
+        return false;
+      }
+      result.*(field.member) = std::move(*value);
+      return true;
+    }());
+  }, fields<T>::value);
+
+  return failed_field;
+}
+
+} // namespace detail
+
+template<Reflectable T>
+std::optional<T> try_unpack(HSQUIRRELVM vm, SQInteger idx)
+{
+  idx = absolute_index(vm, idx);
+
+  if (sq_gettype(vm, idx) != OT_TABLE) {
+    return std::nullopt;
+  }
+
+  T result{};
+  if (detail::unpack_fields(vm, idx, result)) {
+    return std::nullopt;
+  }
+  return result;
+}
+
+template<Reflectable T>
+T unpack(HSQUIRRELVM vm, SQInteger idx)
+{
+  idx = absolute_index(vm, idx);
+
+  if (sq_gettype(vm, idx) != OT_TABLE) {
+    throw SquirrelError::from_vm(vm, "failed to retrieve table");
+  }
+
+  T result{};
+  if (std::optional<std::string_view> failed_field = detail::unpack_fields(vm, idx, result)) {
+    throw SquirrelError::from_vm(vm, fmt::format("failed to retrieve '{}' field", *failed_field));
+  }
+  return result;
+}
+
+} // namespace squip
+
+#endif
+
+/* EOF */
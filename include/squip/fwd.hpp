@@ -20,7 +20,22 @@
 namespace squip {
 
 class ArrayContext;
+class Bundle;
+class BundleWriter;
+class EmbeddedScript;
+class EvalCache;
+class FieldRef;
+class JsonWriter;
+class Key;
+struct KeyLiteral;
+class ModuleLoader;
+class MappedFile;
+class NativeRegistry;
+struct NativeFunction;
+template<typename T> class NumericArray;
 class Object;
+class ScriptCache;
+class ScriptReloader;
 class SquirrelError;
 class SquirrelVM;
 class StackContext;
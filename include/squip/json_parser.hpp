@@ -0,0 +1,43 @@
+// squip - Utilities for Squirrel
+// Copyright (C) 2023 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef HEADER_SQUIP_JSON_PARSER_HPP
+#define HEADER_SQUIP_JSON_PARSER_HPP
+
+#include <string_view>
+
+#include <squirrel.h>
+
+#include "squip/fwd.hpp"
+
+namespace squip {
+
+/** Parse the JSON document in text and push the resulting value onto
+    the stack. Elements are collected on the VM stack while parsing,
+    so each array and table is created once with its final size.
+    Object keys that repeat throughout the document are interned once.
+    Throws std::runtime_error on malformed input, in which case the
+    stack is left unchanged. */
+void parse_json(HSQUIRRELVM vm, std::string_view text);
+
+/** Register parse_json(str) as script function in table */
+void register_json_parser(TableContext& table);
+
+} // namespace squip
+
+#endif
+
+/* EOF */
@@ -0,0 +1,94 @@
+// squip - Utilities for Squirrel
+// Copyright (C) 2023 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef HEADER_SQUIP_JSON_WRITER_HPP
+#define HEADER_SQUIP_JSON_WRITER_HPP
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fmt/format.h>
+#include <squirrel.h>
+
+namespace squip {
+
+/** Streaming JSON serializer for Squirrel values. Output is collected
+    in a buffer of roughly chunk_size bytes and handed to the sink
+    whenever that fills up, so memory use is bounded regardless of the
+    size of the document. Tables and arrays that contain themselves
+    throw std::runtime_error, as do values that have no JSON
+    representation (closures, instances, userdata, ...). Output is
+    partial on error: chunks already handed to the sink stay there, so
+    sinks that need all-or-nothing behaviour have to collect the data
+    themselves and only commit it once write() returns. */
+class JsonWriter
+{
+public:
+  using Sink = std::function<void (std::string_view)>;
+
+  /** Returns a sink that writes to the file descriptor fd, the
+      descriptor is not closed */
+  static Sink fd_sink(int fd);
+
+public:
+  JsonWriter(Sink sink, bool pretty = false, size_t chunk_size = 64 * 1024);
+  ~JsonWriter();
+
+  /** Write the value at idx as a complete JSON document and flush
+      the output, the stack is left unchanged. On error the sink may
+      have received the beginning of the document. */
+  void write(HSQUIRRELVM vm, SQInteger idx);
+
+  /** Hand all buffered output to the sink */
+  void flush();
+
+private:
+  void write_value(HSQUIRRELVM vm, SQInteger idx, int indent);
+  void write_table(HSQUIRRELVM vm, SQInteger idx, int indent);
+  void write_array(HSQUIRRELVM vm, SQInteger idx, int indent);
+  void write_key(HSQUIRRELVM vm, SQInteger idx);
+  void write_string(std::string_view str);
+  void write_newline(int indent);
+
+  void enter(HSQUIRRELVM vm, SQInteger idx);
+  void leave();
+
+  void maybe_flush();
+
+private:
+  Sink m_sink;
+  bool m_pretty;
+  size_t m_chunk_size;
+  fmt::memory_buffer m_buffer;
+
+  /** tables and arrays on the path from the root to the current value */
+  std::vector<void const*> m_path;
+
+public:
+  JsonWriter(JsonWriter const&) = delete;
+  JsonWriter& operator=(JsonWriter const&) = delete;
+};
+
+/** Convenience function that returns the value at idx as JSON */
+std::string to_json(HSQUIRRELVM vm, SQInteger idx, bool pretty = false);
+
+} // namespace squip
+
+#endif
+
+/* EOF */
@@ -0,0 +1,113 @@
+// squip - Utilities for Squirrel
+// Copyright (C) 2023 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef HEADER_SQUIP_KEY_HPP
+#define HEADER_SQUIP_KEY_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include <squirrel.h>
+
+#include "squip/object.hpp"
+
+namespace squip {
+
+/** Table key backed by a string that is interned once, so that
+    lookups via TableContext push the handle instead of hashing and
+    interning the name on every access. A Key holds a reference into
+    the VM it was created for and must only be used with that VM and
+    its threads, it must be destroyed before the VM is closed. */
+class Key
+{
+public:
+  Key(HSQUIRRELVM vm, std::string_view name);
+
+  void push(HSQUIRRELVM vm) const { sq_pushobject(vm, m_object.get_handle()); }
+
+  std::string const& get_name() const { return m_name; }
+  HSQOBJECT get_handle() const { return m_object.get_handle(); }
+
+private:
+  std::string m_name;
+  Object m_object;
+};
+
+namespace detail {
+
+/** String literal usable as template argument for the _key literal */
+template<size_t N>
+struct KeyString
+{
+  consteval KeyString(char const (&str)[N]) :
+    value()
+  {
+    std::copy_n(str, N, value);
+  }
+
+  char value[N];
+};
+
+/** Forwards to SquirrelVM::allocate_key_slot(), which key.hpp can't
+    include */
+size_t allocate_key_literal_slot();
+
+/** Slot of the _key literal S in SquirrelVM::get_interned_keys() */
+template<KeyString S>
+size_t key_literal_slot()
+{
+  static size_t const slot = allocate_key_literal_slot();
+  return slot;
+}
+
+} // namespace detail
+
+/** Compile-time key name as produced by the _key literal. When used
+    with a VM owned by a SquirrelVM the name is interned as a Key on
+    first use and cached in that SquirrelVM, with any other VM it
+    falls back to pushing the name as string. */
+struct KeyLiteral
+{
+  std::string_view name;
+  size_t (*slot)();
+
+  constexpr operator std::string_view() const { return name; }
+
+  /** Return the Key interned for name in the SquirrelVM owning vm,
+      nullptr when vm isn't owned by a SquirrelVM */
+  Key const* resolve(HSQUIRRELVM vm) const;
+
+  void push(HSQUIRRELVM vm) const;
+};
+
+inline namespace literals {
+
+template<detail::KeyString S>
+consteval KeyLiteral operator""_key()
+{
+  return KeyLiteral{std::string_view(S.value, sizeof(S.value) - 1),
+                    &detail::key_literal_slot<S>};
+}
+
+} // namespace literals
+
+} // namespace squip
+
+#endif
+
+/* EOF */
@@ -0,0 +1,71 @@
+// squip - Utilities for Squirrel
+// Copyright (C) 2023 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef HEADER_SQUIP_MAPPED_FILE_HPP
+#define HEADER_SQUIP_MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace squip {
+
+/** Read-only memory mapping of a whole file, the mapping is released
+    in the destructor. Files that can't be mapped, such as pipes or
+    /proc files, are read into a buffer instead. */
+class MappedFile
+{
+public:
+  MappedFile(std::filesystem::path const& path);
+  ~MappedFile();
+
+  MappedFile(MappedFile&& other);
+  MappedFile& operator=(MappedFile&& other);
+
+  std::span<std::byte const> get_data() const {
+    return {static_cast<std::byte const*>(m_data), m_size};
+  }
+
+  std::string_view get_text() const {
+    return {static_cast<char const*>(m_data), m_size};
+  }
+
+  size_t size() const { return m_size; }
+
+private:
+  void read_fd(int fd);
+  void release();
+
+private:
+  void* m_data;
+  size_t m_size;
+  bool m_mapped;
+
+  /** holds the contents when the file isn't mapped */
+  std::vector<std::byte> m_buffer;
+
+public:
+  MappedFile(MappedFile const&) = delete;
+  MappedFile& operator=(MappedFile const&) = delete;
+};
+
+} // namespace squip
+
+#endif
+
+/* EOF */
@@ -0,0 +1,111 @@
+// squip - Utilities for Squirrel
+// Copyright (C) 2023 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef HEADER_SQUIP_MODULE_LOADER_HPP
+#define HEADER_SQUIP_MODULE_LOADER_HPP
+
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <squirrel.h>
+
+#include "squip/fwd.hpp"
+
+namespace squip {
+
+/** Lazy module system behind a native require(name) function.
+
+    Modules are looked up as "name.nut" in the registered bundles
+    first and the search paths second. A module is compiled and run on
+    first use with a fresh table as 'this', that table delegates to the
+    roottable, so globals stay accessible. The module exports that
+    table, or whatever the module returns when that is not null. The
+    export is cached, so further require() calls of the same name are
+    a single lookup. A module that is required while it is still
+    loading (cyclic require) sees its partially filled table.
+
+    The ModuleLoader must outlive any use of require() and be
+    destroyed before the SquirrelVM. */
+class ModuleLoader
+{
+public:
+  ModuleLoader(SquirrelVM& sqvm);
+  ~ModuleLoader();
+
+  void add_search_path(std::filesystem::path path);
+
+  /** The bundle is not owned and must outlive the ModuleLoader */
+  void add_bundle(Bundle& bundle);
+
+  /** Register the require() function in table */
+  void store_require(TableContext& table, std::string_view name = "require");
+
+  /** Push the exports of module name on the stack, loading it on first use */
+  void require(HSQUIRRELVM vm, std::string_view name);
+
+  bool is_loaded(std::string_view name) const;
+
+  /** Recompile and rerun an already loaded module from its file. The
+      new definitions are collected in a staging table and only
+      replace the contents of the existing export table once the
+      module ran successfully, so users holding on to the export see
+      the update all at once and nothing at all on failure. Only
+      table exports are updated in place, when either the old or the
+      new export is anything else the cached export is replaced, so
+      later require() calls see the new value while references taken
+      before keep the stale one. */
+  void reload(HSQUIRRELVM vm, std::string_view name);
+
+  /** Return the files of all modules that were loaded from a search path */
+  std::map<std::string, std::filesystem::path, std::less<>> get_module_files() const;
+
+  /** Called with the name and file of each module loaded from a
+      search path, after it got compiled and before it runs */
+  void set_load_callback(std::function<void (std::string_view, std::filesystem::path const&)> callback);
+
+private:
+  struct Module
+  {
+    HSQOBJECT exports;
+
+    /** empty for modules loaded from a Bundle */
+    std::filesystem::path path;
+  };
+
+  std::filesystem::path push_module_closure(HSQUIRRELVM vm, std::string_view name);
+  void compile_module_file(HSQUIRRELVM vm, std::filesystem::path const& path);
+
+private:
+  SquirrelVM& m_sqvm;
+  std::vector<std::filesystem::path> m_search_paths;
+  std::vector<Bundle*> m_bundles;
+  std::map<std::string, Module, std::less<>> m_modules;
+  std::function<void (std::string_view, std::filesystem::path const&)> m_load_callback;
+
+public:
+  ModuleLoader(ModuleLoader const&) = delete;
+  ModuleLoader& operator=(ModuleLoader const&) = delete;
+};
+
+} // namespace squip
+
+#endif
+
+/* EOF */
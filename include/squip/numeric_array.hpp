@@ -0,0 +1,90 @@
+// squip - Utilities for Squirrel
+// Copyright (C) 2023 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef HEADER_SQUIP_NUMERIC_ARRAY_HPP
+#define HEADER_SQUIP_NUMERIC_ARRAY_HPP
+
+#include <cstdint>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include <squirrel.h>
+
+#include "squip/fwd.hpp"
+
+namespace squip {
+
+/** Contiguous buffer of numbers exposed to scripts as Float32Array,
+    Float64Array and Int32Array. Element-wise operations run as plain
+    loops over the storage instead of per element SQObject access. */
+template<typename T>
+class NumericArray
+{
+public:
+  /** Type used for reductions, integer results wrap around on overflow */
+  using accum_type = std::conditional_t<std::is_integral_v<T>, SQInteger, double>;
+
+public:
+  explicit NumericArray(SQInteger size);
+
+  SQInteger len() const { return static_cast<SQInteger>(m_data.size()); }
+
+  T get(SQInteger idx) const;
+  void set(SQInteger idx, T value);
+
+  void fill(T value);
+  void clamp(T lo, T hi);
+  void add_scalar(T value);
+  void mul_scalar(T value);
+
+  /** this += other */
+  void add(NumericArray const& other);
+
+  /** this *= other */
+  void mul(NumericArray const& other);
+
+  /** this += a * b */
+  void fma(NumericArray const& a, NumericArray const& b);
+
+  /** this += a * b */
+  void fma_scalar(NumericArray const& a, T b);
+
+  accum_type dot(NumericArray const& other) const;
+  accum_type sum() const;
+
+  std::span<T> get_data() { return m_data; }
+  std::span<T const> get_data() const { return m_data; }
+
+private:
+  void check_size(NumericArray const& other) const;
+
+private:
+  std::vector<T> m_data;
+};
+
+using Float32Array = NumericArray<float>;
+using Float64Array = NumericArray<double>;
+using Int32Array = NumericArray<int32_t>;
+
+/** Register the Float32Array, Float64Array and Int32Array classes in table */
+void register_numeric_arrays(TableContext& table);
+
+} // namespace squip
+
+#endif
+
+/* EOF */
@@ -0,0 +1,47 @@
+// squip - Utilities for Squirrel
+// Copyright (C) 2023 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef HEADER_SQUIP_PRECOMPILE_HPP
+#define HEADER_SQUIP_PRECOMPILE_HPP
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+#include <squirrel.h>
+
+namespace squip {
+
+/** Compile the given files on a pool of num_threads worker threads
+    (0 picks the number of cores), each worker using its own scratch
+    SquirrelVM. The serialized closures are returned in the order of
+    paths and can be loaded into the main VM with read_closure(). If
+    any file fails to compile the first error is rethrown after all
+    workers have finished. */
+std::vector<std::vector<std::byte>> precompile_files(std::span<std::filesystem::path const> paths,
+                                                     unsigned int num_threads = 0);
+
+/** Like precompile_files(), but also loads the results into vm,
+    pushing one closure per path on the stack */
+void compile_files(HSQUIRRELVM vm, std::span<std::filesystem::path const> paths,
+                   unsigned int num_threads = 0);
+
+} // namespace squip
+
+#endif
+
+/* EOF */
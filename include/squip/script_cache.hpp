@@ -0,0 +1,71 @@
+// squip - Utilities for Squirrel
+// Copyright (C) 2023 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef HEADER_SQUIP_SCRIPT_CACHE_HPP
+#define HEADER_SQUIP_SCRIPT_CACHE_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+#include <squirrel.h>
+
+namespace squip {
+
+/** On-disk cache of compiled closures. Entries are keyed by a hash
+    of the source text and sourcename along with the Squirrel version,
+    the width of SQChar, SQInteger and SQFloat and whether the VM has
+    debug info enabled, so bytecode from an incompatible build or
+    compiled with a different debug info setting is never picked up.
+    A cache hit skips the compiler and loads the closure with
+    read_closure(). */
+class ScriptCache
+{
+public:
+  ScriptCache(std::filesystem::path directory);
+  ~ScriptCache();
+
+  /** Like squip::compile_buffer(), leaves the closure on the stack */
+  void compile_buffer(HSQUIRRELVM vm, std::string_view buffer,
+                      const std::string& sourcename);
+
+  /** Like squip::compile_file(), leaves the closure on the stack */
+  void compile_file(HSQUIRRELVM vm, std::filesystem::path const& path);
+
+  /** Remove all entries from the cache directory */
+  void clear();
+
+  std::filesystem::path const& get_directory() const { return m_directory; }
+
+  uint64_t get_hits() const { return m_hits; }
+  uint64_t get_misses() const { return m_misses; }
+
+private:
+  std::filesystem::path m_directory;
+  uint64_t m_hits;
+  uint64_t m_misses;
+
+public:
+  ScriptCache(ScriptCache const&) = delete;
+  ScriptCache& operator=(ScriptCache const&) = delete;
+};
+
+} // namespace squip
+
+#endif
+
+/* EOF */
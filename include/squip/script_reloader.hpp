@@ -0,0 +1,89 @@
+// squip - Utilities for Squirrel
+// Copyright (C) 2023 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef HEADER_SQUIP_SCRIPT_RELOADER_HPP
+#define HEADER_SQUIP_SCRIPT_RELOADER_HPP
+
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <squirrel.h>
+
+#include "squip/fwd.hpp"
+
+namespace squip {
+
+/** Outcome of reloading a single module */
+struct ReloadReport
+{
+  std::string module;
+  std::filesystem::path path;
+  std::chrono::steady_clock::duration duration;
+  bool success;
+
+  /** error message when success is false */
+  std::string error;
+};
+
+/** Watches the files of the modules loaded by a ModuleLoader with
+    inotify and reloads modules whose file changed. Only the changed
+    modules are recompiled, see ModuleLoader::reload(). Directories
+    are watched instead of files, so editors that save by renaming a
+    new file into place are picked up as well. Modules are watched as
+    soon as they are loaded, the ScriptReloader installs the
+    ModuleLoader's load callback, so only one ScriptReloader can be
+    attached to a ModuleLoader at a time.
+
+    Only modules exporting a table are updated in place. Any other
+    export is swapped, so references obtained from require() before
+    the reload keep the stale value.
+
+    poll() never blocks and is meant to be called from the main loop,
+    get_fd() can be used to wait for changes with poll(2) or select(2). */
+class ScriptReloader
+{
+public:
+  ScriptReloader(ModuleLoader& loader);
+  ~ScriptReloader();
+
+  /** Reload all modules whose files changed since the last call */
+  std::vector<ReloadReport> poll(HSQUIRRELVM vm);
+
+  int get_fd() const { return m_fd; }
+
+private:
+  void add_watch(std::filesystem::path const& path);
+
+private:
+  ModuleLoader& m_loader;
+  int m_fd;
+
+  /** watch descriptor to watched directory */
+  std::map<int, std::filesystem::path> m_watches;
+
+public:
+  ScriptReloader(ScriptReloader const&) = delete;
+  ScriptReloader& operator=(ScriptReloader const&) = delete;
+};
+
+} // namespace squip
+
+#endif
+
+/* EOF */
@@ -17,13 +17,44 @@
 #ifndef HEADER_SQUIP_SERIALIZE_HPP
 #define HEADER_SQUIP_SERIALIZE_HPP
 
+#include <cstddef>
+#include <filesystem>
+#include <iosfwd>
+#include <span>
+#include <vector>
+
 #include <squirrel.h>
 
-class ReaderMapping;
-class Writer;
+namespace squip {
+
+/** Serialize the table at table_idx into squip's compact binary table
+    format and append it to out. Supported are null, bool, integer,
+    float, string, table and array values, closures in tables are
+    skipped and in arrays written as null, other types throw
+    std::runtime_error. Strings are deduplicated. Tables that are
+    referenced more than once are written as separate copies, tables
+    that contain themselves throw. On error out and the stack are left
+    as they were. */
+void save_squirrel_table(HSQUIRRELVM vm, SQInteger table_idx, std::vector<std::byte>& out);
+
+/** Like above, but write the data to out in chunks, on error out may
+    have received part of the data */
+void save_squirrel_table(HSQUIRRELVM vm, SQInteger table_idx, std::ostream& out);
+
+/** Like above, the data goes to a temporary file that is renamed to
+    path once complete, a failed save leaves an existing file alone */
+void save_squirrel_table(HSQUIRRELVM vm, SQInteger table_idx, std::filesystem::path const& path);
+
+/** Read data written by save_squirrel_table() and store the entries
+    in the table at table_idx, existing keys are overwritten. Returns
+    the number of bytes consumed. Throws std::runtime_error on
+    malformed data, entries read up to that point stay in the table. */
+size_t load_squirrel_table(HSQUIRRELVM vm, SQInteger table_idx, std::span<std::byte const> data);
+
+/** Like above, the file is memory mapped instead of read */
+void load_squirrel_table(HSQUIRRELVM vm, SQInteger table_idx, std::filesystem::path const& path);
 
-void save_squirrel_table(HSQUIRRELVM vm, SQInteger table_idx, Writer& writer);
-void load_squirrel_table(HSQUIRRELVM vm, SQInteger table_idx, const ReaderMapping& mapping);
+} // namespace squip
 
 #endif
 
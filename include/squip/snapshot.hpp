@@ -0,0 +1,98 @@
+// squip - Utilities for Squirrel
+// Copyright (C) 2023 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef HEADER_SQUIP_SNAPSHOT_HPP
+#define HEADER_SQUIP_SNAPSHOT_HPP
+
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <squirrel.h>
+
+#include "squip/fwd.hpp"
+
+namespace squip {
+
+/** Native closures can't be serialized, snapshots refer to them by
+    their closure name and the NativeRegistry provides them again when
+    the snapshot is loaded. store_function() and store_c_function()
+    name the closure after the table entry. */
+class NativeRegistry
+{
+public:
+  NativeRegistry();
+  ~NativeRegistry();
+
+  void add(std::string_view name, SQChar const* typemask, SQFUNCTION func);
+  void add(std::string_view name, SQChar const* typemask, std::function<SQInteger (HSQUIRRELVM)> func);
+  void add(std::string_view name, NativeFunction const& func);
+
+  /** Register every named native closure in the table at idx, such as
+      the builtins in the root table of a fresh VM. The closures are
+      referenced, so the registry must not outlive the VM. */
+  void add_table(HSQUIRRELVM vm, SQInteger idx);
+
+  /** Push the native registered as name, returns false if there is none */
+  bool push(HSQUIRRELVM vm, std::string_view name) const;
+
+  size_t size() const { return m_natives.size(); }
+
+private:
+  std::map<std::string, std::function<void (HSQUIRRELVM)>, std::less<>> m_natives;
+
+public:
+  NativeRegistry(NativeRegistry const&) = delete;
+  NativeRegistry& operator=(NativeRegistry const&) = delete;
+};
+
+/** Serialize the object graph reachable from the root table and
+    append it to out. Tables, arrays, closures (via write_closure()),
+    classes and instances of script classes are written with their
+    identity, so shared and cyclic references survive a restore.
+    Native closures are written by name. Values of other types, such
+    as native classes, userdata or threads, are skipped in tables and
+    written as null in arrays. Closures with free variables can't be
+    serialized and throw. Default parameter values and environments
+    bound with bindenv() are not preserved, restored closures have
+    neither.
+
+    Class metamethods (_tostring, _cmp, _get, ...) are not preserved,
+    Squirrel keeps them apart from the other class members and offers
+    no API to enumerate them. Restored classes and their instances
+    fall back to the default behaviour. */
+void save_snapshot(HSQUIRRELVM vm, std::vector<std::byte>& out);
+
+/** Like above, the data goes to a temporary file that is renamed to
+    path once complete, a failed save leaves an existing file alone */
+void save_snapshot(HSQUIRRELVM vm, std::filesystem::path const& path);
+
+/** Restore a snapshot into the root table of vm, existing entries
+    with the same key are overwritten. Throws std::runtime_error on
+    malformed data or natives missing from registry. */
+void load_snapshot(HSQUIRRELVM vm, std::span<std::byte const> data, NativeRegistry const& registry);
+void load_snapshot(HSQUIRRELVM vm, std::filesystem::path const& path, NativeRegistry const& registry);
+
+} // namespace squip
+
+#endif
+
+/* EOF */
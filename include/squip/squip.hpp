@@ -19,7 +19,23 @@
 
 #include <string>
 
+#include "bind.hpp"
+#include "bundle.hpp"
+#include "class_binding.hpp"
+#include "embedded_scripts.hpp"
+#include "eval_cache.hpp"
+#include "field_ref.hpp"
+#include "fields.hpp"
+#include "json_parser.hpp"
+#include "json_writer.hpp"
+#include "key.hpp"
+#include "module_loader.hpp"
+#include "numeric_array.hpp"
+#include "precompile.hpp"
+#include "script_cache.hpp"
+#include "script_reloader.hpp"
 #include "serialize.hpp"
+#include "snapshot.hpp"
 #include "squip.hpp"
 #include "squirrel_error.hpp"
 #include "squirrel_vm.hpp"
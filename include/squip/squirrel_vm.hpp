@@ -18,12 +18,18 @@
 #ifndef HEADER_SQUIP_SQUIRREL_VM_HPP
 #define HEADER_SQUIP_SQUIRREL_VM_HPP
 
+#include <filesystem>
 #include <functional>
+#include <memory>
+#include <span>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include <squirrel.h>
 
+#include "squip/key.hpp"
+#include "squip/script_cache.hpp"
 #include "squip/squirrel_error.hpp"
 #include "squip/table_context.hpp"
 #include "squip/thread.hpp"
@@ -47,15 +53,34 @@ public:
                                 void (SQChar const*, SQChar const*, SQInteger, SQInteger)> compilererrorhandler);
   void set_errorhandler(std::function<void (HSQUIRRELVM)> errorhandler);
 
+  /** Enable the on-disk bytecode cache for Thread::run_script() */
+  void set_script_cache(std::filesystem::path const& directory);
+  ScriptCache* get_script_cache() const { return m_script_cache.get(); }
+
   Thread create_thread();
 
   StackContext stack() { return StackContext(m_vm); }
 
+  /** Return the keys for names interned in this VM, they are created
+      on first use and cached in the given slot, which must have been
+      allocated with allocate_key_slot() */
+  std::span<Key const> get_interned_keys(size_t slot, std::span<std::string_view const> names);
+
+  /** Allocate a process wide slot for get_interned_keys() */
+  static size_t allocate_key_slot();
+
+  /** Return the SquirrelVM owning vm or nullptr when vm wasn't
+      created through SquirrelVM, the shared foreign pointer is only
+      trusted when the shared release hook is the one installed by
+      the constructor */
+  static SquirrelVM* from_vm(HSQUIRRELVM vm);
+
 private:
   static void my_printfunc(HSQUIRRELVM vm, const char* fmt, ...);
   static void my_errorfunc(HSQUIRRELVM vm, const char* fmt, ...);
   static void my_compilererrorhandler(HSQUIRRELVM vm, SQChar const* desc, SQChar const* source, SQInteger line, SQInteger column);
   static SQRESULT my_errorhandler(HSQUIRRELVM vm);
+  static SQInteger my_releasehook(SQUserPointer ptr, SQInteger size);
 
 private:
   HSQUIRRELVM m_vm;
@@ -64,6 +89,8 @@ private:
   std::function<void (char const*)> m_errorfunc;
   std::function<void (SQChar const*, SQChar const*, SQInteger, SQInteger)> m_compilererrorhandler;
   std::function<void (HSQUIRRELVM)> m_errorhandler;
+  std::unique_ptr<ScriptCache> m_script_cache;
+  std::vector<std::vector<Key>> m_interned_keys;
 
 private:
   SquirrelVM(const SquirrelVM&) = delete;
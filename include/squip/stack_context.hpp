@@ -17,10 +17,14 @@
 #ifndef HEADER_SQUIP_STACK_CONTEXT_HPP
 #define HEADER_SQUIP_STACK_CONTEXT_HPP
 
+#include <optional>
+#include <string_view>
+
 #include <squirrel.h>
 
 #include "squip/array_context.hpp"
 #include "squip/fwd.hpp"
+#include "squip/json_parser.hpp"
 #include "squip/table_context.hpp"
 #include "squip/unpack.hpp"
 #include "squip/util.hpp"
@@ -42,6 +46,12 @@ public:
     return squip::unpack<T>(m_vm, idx);
   }
 
+  template<typename T>
+  std::optional<T> try_get(SQInteger idx)
+  {
+    return squip::try_unpack<T>(m_vm, idx);
+  }
+
   template<typename T>
   void push(T&& value)
   {
@@ -50,6 +60,11 @@ public:
 
   TableContext push_roottable();
 
+  /** Parse text as JSON and push the resulting value, see squip::parse_json() */
+  void push_json(std::string_view text) {
+    squip::parse_json(m_vm, text);
+  }
+
   ArrayContext push_new_array(SQInteger size = 0) {
     return squip::new_array(m_vm, size);
   }
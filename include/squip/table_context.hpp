@@ -19,14 +19,17 @@
 #define HEADER_SQUIP_TABLE_CONTEXT_HPP
 
 #include <functional>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <vector>
 
 #include <squirrel.h>
 
+#include "squip/key.hpp"
 #include "squip/squirrel_error.hpp"
 #include "squip/unpack.hpp"
+#include "squip/util.hpp"
 
 namespace squip {
 
@@ -46,7 +49,11 @@ public:
   TableContext(HSQUIRRELVM vm, SQInteger idx);
   ~TableContext();
 
+  HSQUIRRELVM get_vm() const { return m_vm; }
+
   bool has_key(std::string_view name);
+  bool has_key(Key const& key);
+  bool has_key(KeyLiteral const& key);
 
   template<typename T>
   void store(std::string_view name, T&& val)
@@ -58,6 +65,26 @@ public:
     }
   }
 
+  template<typename T>
+  void store(Key const& key, T&& val)
+  {
+    key.push(m_vm);
+    push_value(m_vm, std::forward<T>(val));
+    if (SQ_FAILED(sq_createslot(m_vm, m_idx))) {
+      throw SquirrelError::from_vm(m_vm, "failed to store value in table");
+    }
+  }
+
+  template<typename T>
+  void store(KeyLiteral const& key, T&& val)
+  {
+    key.push(m_vm);
+    push_value(m_vm, std::forward<T>(val));
+    if (SQ_FAILED(sq_createslot(m_vm, m_idx))) {
+      throw SquirrelError::from_vm(m_vm, "failed to store value in table");
+    }
+  }
+
   /* typemask:
      ‘o’ null
      ‘i’ integer
@@ -79,13 +106,63 @@ public:
   */
   void store_c_function(std::string_view name, char const* typemask, SQFUNCTION func);
   void store_function(std::string_view name, const char* typemask, std::function<SQInteger (HSQUIRRELVM)> func);
+  void store_function(std::string_view name, NativeFunction const& func);
+
+  template<typename F>
+  void store_closure(std::string_view name, const char* typemask, F&& func)
+  {
+    sq_pushstring(m_vm, name.data(), name.size());
+    push_closure(m_vm, std::forward<F>(func));
+    sq_setnativeclosurename(m_vm, -1, std::string(name).c_str());
+    sq_setparamscheck(m_vm, SQ_MATCHTYPEMASKSTRING, typemask);
+
+    if (SQ_FAILED(sq_createslot(m_vm, m_idx))) {
+      throw SquirrelError::from_vm(m_vm, "failed to register function");
+    }
+  }
 
   template<typename T>
   bool read(std::string_view name, T& val)
   {
-    if (!has_key(name)) return false;
-    val = get<T>(name);
-    return true;
+    sq_pushstring(m_vm, name.data(), name.size());
+    return read_entry(val);
+  }
+
+  template<typename T>
+  bool read(Key const& key, T& val)
+  {
+    key.push(m_vm);
+    return read_entry(val);
+  }
+
+  template<typename T>
+  bool read(KeyLiteral const& key, T& val)
+  {
+    key.push(m_vm);
+    return read_entry(val);
+  }
+
+  /** Look up the entry once and unpack it, returns std::nullopt when
+      the entry is missing or of the wrong type, never throws */
+  template<typename T>
+  std::optional<T> try_get(std::string_view name)
+  {
+    sq_pushstring(m_vm, name.data(), name.size());
+    return try_get_entry<T>();
+  }
+
+  template<typename T>
+  std::optional<T> try_get(Key const& key)
+  {
+    key.push(m_vm);
+    return try_get_entry<T>();
+  }
+
+  template<typename T>
+  std::optional<T> try_get(KeyLiteral const& key)
+  {
+    key.push(m_vm);
+    return try_get_entry<T>();
   }
 
   template<typename T>
@@ -99,15 +176,78 @@ public:
     return result;
   }
 
+  template<typename T>
+  T get(Key const& key)
+  {
+    get_entry(key);
+
+    T result = squip::unpack<T>(m_vm, -1);
+    sq_pop(m_vm, 1);
+
+    return result;
+  }
+
+  template<typename T>
+  T get(KeyLiteral const& key)
+  {
+    get_entry(key);
+
+    T result = squip::unpack<T>(m_vm, -1);
+    sq_pop(m_vm, 1);
+
+    return result;
+  }
+
   void get_entry(std::string_view name);
+  void get_entry(Key const& key);
+  void get_entry(KeyLiteral const& key);
   void delete_entry(std::string_view name);
+  void delete_entry(Key const& key);
+  void delete_entry(KeyLiteral const& key);
   void rename_entry(std::string_view oldname, std::string_view newname);
+  void rename_entry(Key const& oldkey, Key const& newkey);
+  void rename_entry(KeyLiteral const& oldkey, KeyLiteral const& newkey);
   std::vector<std::string> get_keys();
 
   TableContext create_table(std::string_view name);
+  TableContext create_table(Key const& key);
+  TableContext create_table(KeyLiteral const& key);
   TableContext create_or_get_table(std::string_view name);
+  TableContext create_or_get_table(Key const& key);
+  TableContext create_or_get_table(KeyLiteral const& key);
 
 private:
+  /** Move the entry under the key on top of the stack to the key
+      below it, both keys are popped */
+  void rename_pushed_entry(std::string_view oldname);
+
+  /** Store the table below the key on top of the stack under that
+      key, the key is popped and the table stays on the stack */
+  TableContext store_new_table(std::string_view name);
+
+  /** Lookup the key on top of the stack, unpack the value into val */
+  template<typename T>
+  bool read_entry(T& val)
+  {
+    if (SQ_FAILED(sq_get(m_vm, m_idx))) {
+      return false;
+    }
+    val = squip::unpack<T>(m_vm, -1);
+    sq_pop(m_vm, 1);
+    return true;
+  }
+
+  template<typename T>
+  std::optional<T> try_get_entry()
+  {
+    if (SQ_FAILED(sq_get(m_vm, m_idx))) {
+      return std::nullopt;
+    }
+    std::optional<T> result = squip::try_unpack<T>(m_vm, -1);
+    sq_pop(m_vm, 1);
+    return result;
+  }
+
   HSQUIRRELVM m_vm;
   SQInteger m_idx;
 
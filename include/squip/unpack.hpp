@@ -17,9 +17,18 @@
 #ifndef HEADER_SQUIP_UNPACK_HPP
 #define HEADER_SQUIP_UNPACK_HPP
 
+#include <cstddef>
 #include <iostream>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#include <fmt/format.h>
 #include <squirrel.h>
 
 #include "squip/squirrel_error.hpp"
@@ -27,128 +36,295 @@
 
 namespace squip {
 
+/** Non-throwing variant of unpack(), returns std::nullopt when the
+    value at idx can't be converted to T. This is the one place where
+    support for a type is added, unpack() is built on top of it. */
 template<typename T>
-T unpack(HSQUIRRELVM vm, SQInteger idx) = delete;
+std::optional<T> try_unpack(HSQUIRRELVM vm, SQInteger idx) = delete;
+
+/** Unpack a table into an aggregate described by squip::fields<T>,
+    defined in squip/fields.hpp */
+template<Reflectable T>
+std::optional<T> try_unpack(HSQUIRRELVM vm, SQInteger idx);
+
+template<Reflectable T>
+T unpack(HSQUIRRELVM vm, SQInteger idx);
+
+namespace detail {
+
+/** Name of T as used in error messages */
+template<typename T>
+constexpr char const* type_description()
+{
+  if constexpr (std::is_same_v<T, bool> || std::is_same_v<T, SQBool>) {
+    return "bool";
+  } else if constexpr (std::is_integral_v<T>) {
+    return "integer";
+  } else if constexpr (std::is_floating_point_v<T>) {
+    return "float";
+  } else if constexpr (std::is_convertible_v<T, std::string_view>) {
+    return "string";
+  } else {
+    return "array";
+  }
+}
+
+} // namespace detail
+
+/** Unpack the value at idx as T, throws SquirrelError when it can't
+    be converted */
+template<typename T>
+T unpack(HSQUIRRELVM vm, SQInteger idx)
+{
+  std::optional<T> value = try_unpack<T>(vm, idx);
+  if (!value) {
+    throw SquirrelError::from_vm(vm, fmt::format("failed to retrieve {}", detail::type_description<T>()));
+  }
+  return std::move(*value);
+}
 
 template<>
 inline
-SQBool unpack<SQBool>(HSQUIRRELVM vm, SQInteger idx)
+std::optional<SQBool> try_unpack<SQBool>(HSQUIRRELVM vm, SQInteger idx)
 {
   SQBool value;
   if (SQ_FAILED(sq_getbool(vm, idx, &value))) {
-    throw SquirrelError::from_vm(vm, "failed to retrieve bool");
+    return std::nullopt;
   }
   return value;
 }
 
 template<>
 inline
-SQInteger unpack<SQInteger>(HSQUIRRELVM vm, SQInteger idx)
+std::optional<SQInteger> try_unpack<SQInteger>(HSQUIRRELVM vm, SQInteger idx)
 {
   SQInteger value;
   if (SQ_FAILED(sq_getinteger(vm, idx, &value))) {
-    throw SquirrelError::from_vm(vm, "failed to retrieve integer");
+    return std::nullopt;
   }
   return value;
 }
 
 template<>
 inline
-SQFloat unpack<SQFloat>(HSQUIRRELVM vm, SQInteger idx)
+std::optional<SQFloat> try_unpack<SQFloat>(HSQUIRRELVM vm, SQInteger idx)
 {
   SQFloat value;
   if (SQ_FAILED(sq_getfloat(vm, idx, &value))) {
-    throw SquirrelError::from_vm(vm, "failed to retrieve float");
+    return std::nullopt;
   }
   return value;
 }
 
 template<>
 inline
-SQChar const* unpack<SQChar const*>(HSQUIRRELVM vm, SQInteger idx)
+std::optional<SQChar const*> try_unpack<SQChar const*>(HSQUIRRELVM vm, SQInteger idx)
 {
   SQChar const* value;
   if (SQ_FAILED(sq_getstring(vm, idx, &value))) {
-    throw SquirrelError::from_vm(vm, "failed to retrieve string");
+    return std::nullopt;
   }
   return value;
 }
 
 template<>
 inline
-bool unpack<bool>(HSQUIRRELVM vm, SQInteger idx)
+std::optional<bool> try_unpack<bool>(HSQUIRRELVM vm, SQInteger idx)
 {
-  return unpack<SQBool>(vm, idx) != SQFalse;
+  if (auto value = try_unpack<SQBool>(vm, idx)) {
+    return *value != SQFalse;
+  }
+  return std::nullopt;
 }
 
 template<>
 inline
-int unpack<int>(HSQUIRRELVM vm, SQInteger idx)
+std::optional<int> try_unpack<int>(HSQUIRRELVM vm, SQInteger idx)
 {
-  return static_cast<int>(unpack<SQInteger>(vm, idx));
+  if (auto value = try_unpack<SQInteger>(vm, idx)) {
+    return static_cast<int>(*value);
+  }
+  return std::nullopt;
 }
 
+/** Returns a view into the string stored in the VM without copying.
+    The view is only valid as long as the string object is referenced
+    by the VM, e.g. for the duration of a native call when taken from
+    the call's arguments. Do not keep it after popping the string or
+    returning from the native function. */
 template<>
 inline
-std::string unpack<std::string>(HSQUIRRELVM vm, SQInteger idx)
+std::optional<std::string_view> try_unpack<std::string_view>(HSQUIRRELVM vm, SQInteger idx)
 {
   SQChar const* value;
   SQInteger size;
   if (SQ_FAILED(sq_getstringandsize(vm, idx, &value, &size))) {
-    throw SquirrelError::from_vm(vm, "failed to retrieve string");
+    return std::nullopt;
+  }
+  return std::string_view(value, static_cast<size_t>(size));
+}
+
+template<>
+inline
+std::optional<std::string> try_unpack<std::string>(HSQUIRRELVM vm, SQInteger idx)
+{
+  if (auto value = try_unpack<std::string_view>(vm, idx)) {
+    return std::string(*value);
   }
-  return std::string(value, size);
+  return std::nullopt;
 }
 
+namespace detail {
+
+/** Push array element i of the array at absolute index idx */
+inline
+void push_array_element(HSQUIRRELVM vm, SQInteger idx, SQInteger i)
+{
+  sq_pushinteger(vm, i);
+  if (SQ_FAILED(sq_get(vm, idx))) {
+    throw SquirrelError::from_vm(vm, "failed to retrieve array element");
+  }
+}
+
+} // namespace detail
+
+/** Fill out with the elements of the array at idx without allocating,
+    returns the number of elements written. Throws if the array does
+    not fit into out. */
 template<typename T>
 inline
-std::vector<T> unpack_array(HSQUIRRELVM vm, SQInteger idx)
+size_t unpack_into(HSQUIRRELVM vm, SQInteger idx, std::span<T> out)
+{
+  idx = absolute_index(vm, idx);
+
+  if (sq_gettype(vm, idx) != OT_ARRAY) {
+    throw SquirrelError::from_vm(vm, "failed to retrieve array");
+  }
+
+  SQInteger const size = sq_getsize(vm, idx);
+  if (static_cast<size_t>(size) > out.size()) {
+    throw SquirrelError::from_vm(vm, "array does not fit into output buffer");
+  }
+
+  // don't leave the element behind when it can't be converted
+  SQInteger const oldtop = sq_gettop(vm);
+  try {
+    for (SQInteger i = 0; i < size; ++i) {
+      detail::push_array_element(vm, idx, i);
+      out[static_cast<size_t>(i)] = unpack<T>(vm, -1);
+      sq_poptop(vm);
+    }
+  } catch (...) {
+    sq_settop(vm, oldtop);
+    throw;
+  }
+
+  return static_cast<size_t>(size);
+}
+
+/** Collect the values of the array, table, class or instance at idx,
+    returns std::nullopt when idx holds anything else or an element
+    can't be converted to T */
+template<typename T>
+inline
+std::optional<std::vector<T>> try_unpack_array(HSQUIRRELVM vm, SQInteger idx)
 {
   idx = absolute_index(vm, idx);
 
   std::vector<T> value;
-  sq_pushnull(vm);  // iterator
-  while (SQ_SUCCEEDED(sq_next(vm, idx)))
+
+  switch (sq_gettype(vm, idx))
   {
-    // here -1 is the value and -2 is the key
-    // we ignore the key, since that is just the index in an array
-    value.emplace_back(unpack<T>(vm, -1));
+    case OT_ARRAY: {
+      // fast path: size the vector once and read the elements by index
+      SQInteger const size = sq_getsize(vm, idx);
+      value.reserve(static_cast<size_t>(size));
+      for (SQInteger i = 0; i < size; ++i) {
+        sq_pushinteger(vm, i);
+        if (SQ_FAILED(sq_get(vm, idx))) {
+          return std::nullopt;
+        }
+        std::optional<T> element = try_unpack<T>(vm, -1);
+        sq_poptop(vm);
+        if (!element) {
+          return std::nullopt;
+        }
+        value.emplace_back(std::move(*element));
+      }
+      return value;
+    }
 
-    sq_pop(vm, 2); //pops key and val before the nex iteration
+    case OT_TABLE:
+    case OT_CLASS:
+    case OT_INSTANCE:
+      sq_pushnull(vm);  // iterator
+      while (SQ_SUCCEEDED(sq_next(vm, idx)))
+      {
+        // here -1 is the value and -2 is the key, the key is ignored
+        std::optional<T> element = try_unpack<T>(vm, -1);
+        sq_pop(vm, 2);
+        if (!element) {
+          sq_poptop(vm);
+          return std::nullopt;
+        }
+        value.emplace_back(std::move(*element));
+      }
+      sq_poptop(vm);
+      return value;
+
+    default:
+      return std::nullopt;
   }
-  sq_pop(vm, 1);
+}
 
-  return value;
+template<typename T>
+inline
+std::vector<T> unpack_array(HSQUIRRELVM vm, SQInteger idx)
+{
+  std::optional<std::vector<T>> value = try_unpack_array<T>(vm, idx);
+  if (!value) {
+    throw SquirrelError::from_vm(vm, fmt::format("failed to retrieve array of {}", detail::type_description<T>()));
+  }
+  return std::move(*value);
 }
 
 template<>
 inline
-std::vector<SQBool> unpack<std::vector<SQBool>>(HSQUIRRELVM vm, SQInteger idx)
+std::optional<std::vector<SQBool>> try_unpack<std::vector<SQBool>>(HSQUIRRELVM vm, SQInteger idx)
 {
-  return unpack_array<SQBool>(vm, idx);
+  return try_unpack_array<SQBool>(vm, idx);
 }
 
 template<>
 inline
-std::vector<SQInteger> unpack<std::vector<SQInteger>>(HSQUIRRELVM vm, SQInteger idx)
+std::optional<std::vector<SQInteger>> try_unpack<std::vector<SQInteger>>(HSQUIRRELVM vm, SQInteger idx)
 {
-  return unpack_array<SQInteger>(vm, idx);
+  return try_unpack_array<SQInteger>(vm, idx);
 }
 
 template<>
 inline
-std::vector<SQFloat> unpack<std::vector<SQFloat>>(HSQUIRRELVM vm, SQInteger idx)
+std::optional<std::vector<SQFloat>> try_unpack<std::vector<SQFloat>>(HSQUIRRELVM vm, SQInteger idx)
 {
-  return unpack_array<SQFloat>(vm, idx);
+  return try_unpack_array<SQFloat>(vm, idx);
 }
 
 template<>
 inline
-std::vector<SQChar const*> unpack<std::vector<SQChar const*>>(HSQUIRRELVM vm, SQInteger idx)
+std::optional<std::vector<SQChar const*>> try_unpack<std::vector<SQChar const*>>(HSQUIRRELVM vm, SQInteger idx)
 {
-  return unpack_array<SQChar const*>(vm, idx);
+  return try_unpack_array<SQChar const*>(vm, idx);
 }
 
+template<>
+inline
+std::optional<std::vector<std::string_view>> try_unpack<std::vector<std::string_view>>(HSQUIRRELVM vm, SQInteger idx)
+{
+  return try_unpack_array<std::string_view>(vm, idx);
+}
+
+/** Unpack the arguments of a native call starting at idx, the
+    lifetime rules of unpack<std::string_view>() apply to views */
 template<typename T, typename... Args>
 inline
 std::tuple<T, Args...> unpack_args(HSQUIRRELVM vm, SQInteger idx = 2)
@@ -164,3 +340,5 @@ std::tuple<T, Args...> unpack_args(HSQUIRRELVM vm, SQInteger idx = 2)
 } // namespace squip
 
 #endif
+
+/* EOF */
@@ -17,13 +17,29 @@
 #ifndef HEADER_SQUIP_UTIL_HPP
 #define HEADER_SQUIP_UTIL_HPP
 
+#include <array>
 #include <cassert>
+#include <charconv>
+#include <cstddef>
+#include <exception>
+#include <filesystem>
 #include <functional>
+#include <iterator>
 #include <limits>
+#include <map>
 #include <memory>
+#include <new>
+#include <span>
 #include <sstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include <fmt/format.h>
+
 #include "squip/fwd.hpp"
 #include "squip/squirrel_error.hpp"
 
@@ -32,6 +48,22 @@ namespace squip {
 /** Dummy value to allow sq_pushnull() via overloading */
 struct Null {};
 
+/** Native function together with the typemask used for its parameter
+    check, as generated by squip::bind() */
+struct NativeFunction
+{
+  SQFUNCTION function;
+  SQChar const* typemask;
+};
+
+/** Pick object from stack position idx and append a machine readable
+    representation of it to out */
+void repr(HSQUIRRELVM vm, SQInteger idx, fmt::memory_buffer& out, bool pretty = false, int indent = 0);
+
+/** Pick object from stack position idx and append a human readable
+    representation of it to out */
+void print(HSQUIRRELVM vm, SQInteger idx, fmt::memory_buffer& out);
+
 /** Pick object from stack position idx and print it to a machine readable string */
 void repr(HSQUIRRELVM vm, SQInteger idx, std::ostream& os, bool pretty = false, int indent = 0);
 
@@ -51,13 +83,62 @@ SQInteger squirrel_read_char(SQUserPointer file);
 
 HSQUIRRELVM object_to_vm(HSQOBJECT object);
 
+/** Compile the script and leave the resulting closure on the stack */
 void compile_script(HSQUIRRELVM vm, std::istream& in,
                     const std::string& sourcename);
+void compile_buffer(HSQUIRRELVM vm, std::string_view buffer,
+                    const std::string& sourcename);
+void compile_file(HSQUIRRELVM vm, std::filesystem::path const& path);
+
+/** Compile the script and call it with the roottable as 'this' */
 void compile_and_run(HSQUIRRELVM vm, std::istream& in,
                      const std::string& sourcename);
+void compile_and_run(HSQUIRRELVM vm, std::string_view buffer,
+                     const std::string& sourcename);
+void compile_and_run_file(HSQUIRRELVM vm, std::filesystem::path const& path);
+
+/** Call the closure on top of the stack with the roottable as 'this',
+    the closure is popped unless the script got suspended */
+void run_closure(HSQUIRRELVM vm, const std::string& sourcename);
 
 void push_function(HSQUIRRELVM vm, std::function<SQInteger (HSQUIRRELVM)> func);
 
+/** Like push_function(), but stores the callable itself inline in a
+    userdata of sizeof(F) and calls it through a trampoline specific
+    to F, thus avoiding std::function's type erasure and any
+    additional heap allocation for large captures */
+template<typename F>
+void push_closure(HSQUIRRELVM vm, F&& func)
+{
+  using Func = std::decay_t<F>;
+  static_assert(std::is_invocable_r_v<SQInteger, Func&, HSQUIRRELVM>,
+                "push_closure() requires a callable of signature SQInteger (HSQUIRRELVM)");
+  static_assert(alignof(Func) <= alignof(SQInteger),
+                "push_closure() can't store over-aligned callables in userdata");
+
+  // store the callable in a free variable as userdata
+  SQUserPointer userptr = sq_newuserdata(vm, sizeof(Func));
+  new(userptr) Func(std::forward<F>(func));
+  if constexpr (!std::is_trivially_destructible_v<Func>) {
+    sq_setreleasehook(vm, -1, [](SQUserPointer uptr, SQInteger) -> SQInteger {
+      std::launder(reinterpret_cast<Func*>(uptr))->~Func();
+      return 1;
+    });
+  }
+
+  sq_newclosure(vm, [](HSQUIRRELVM vm_) -> SQInteger {
+    SQUserPointer uptr;
+    if (SQ_FAILED(sq_getuserdata(vm_, -1, &uptr, nullptr))) {
+      return sq_throwerror(vm_, "invalid argument, must be userdata");
+    }
+    try {
+      return (*std::launder(reinterpret_cast<Func*>(uptr)))(vm_);
+    } catch (std::exception const& err) {
+      return sq_throwerror(vm_, err.what());
+    }
+  }, 1 /* nfreevars */);
+}
+
 void push_value(HSQUIRRELVM vm, SQBool value);
 void push_value(HSQUIRRELVM vm, SQInteger value);
 void push_value(HSQUIRRELVM vm, SQFloat value);
@@ -66,17 +147,152 @@ void push_value(HSQUIRRELVM vm, SQUserPointer userptr);
 void push_value(HSQUIRRELVM vm, Object const& obj);
 void push_value(HSQUIRRELVM vm, HSQOBJECT const& obj);
 void push_value(HSQUIRRELVM vm, Null const& null);
+void push_value(HSQUIRRELVM vm, NativeFunction const& func);
+void push_value(HSQUIRRELVM vm, Key const& key);
+void push_value(HSQUIRRELVM vm, KeyLiteral const& key);
 
 void push_value(HSQUIRRELVM vm, char const* value);
 void push_value(HSQUIRRELVM vm, bool value);
 void push_value(HSQUIRRELVM vm, int value);
 
+/** Field descriptors for aggregates, see squip/fields.hpp */
+template<typename T>
+struct fields;
+
+template<typename T>
+concept Reflectable = requires { fields<T>::value; };
+
+/** Push an aggregate described by squip::fields<T> as table, defined
+    in squip/fields.hpp */
+template<Reflectable T>
+void push_value(HSQUIRRELVM vm, T const& value);
+
+/** Push containers as arrays and tables, the target is allocated at
+    its final size up front and the elements are pushed via
+    push_value() */
+template<typename T, size_t Extent>
+void push_value(HSQUIRRELVM vm, std::span<T, Extent> values);
+template<typename T, typename Alloc>
+void push_value(HSQUIRRELVM vm, std::vector<T, Alloc> const& values);
+template<typename K, typename V, typename Compare, typename Alloc>
+void push_value(HSQUIRRELVM vm, std::map<K, V, Compare, Alloc> const& values);
+template<typename K, typename V, typename Hash, typename KeyEqual, typename Alloc>
+void push_value(HSQUIRRELVM vm, std::unordered_map<K, V, Hash, KeyEqual, Alloc> const& values);
+
+namespace detail {
+
+/** Append the shortest decimal representation of value to out, used
+    by repr() and JsonWriter */
+template<typename T>
+void append_number(fmt::memory_buffer& out, T value)
+{
+  std::array<char, 64> buf;
+  std::to_chars_result const result = std::to_chars(buf.data(), buf.data() + buf.size(), value);
+  out.append(buf.data(), result.ptr);
+}
+
+template<typename Range>
+void push_array(HSQUIRRELVM vm, Range const& values)
+{
+  // a failed sq_set() leaves key and value behind, so restore the
+  // whole stack, including the new array, on error
+  SQInteger const oldtop = sq_gettop(vm);
+  try {
+    sq_newarray(vm, static_cast<SQInteger>(std::size(values)));
+    SQInteger i = 0;
+    for (auto const& value : values) {
+      sq_pushinteger(vm, i);
+      push_value(vm, value);
+      if (SQ_FAILED(sq_set(vm, -3))) {
+        throw SquirrelError::from_vm(vm, "failed to store array element");
+      }
+      i += 1;
+    }
+  } catch (...) {
+    sq_settop(vm, oldtop);
+    throw;
+  }
+}
+
+template<typename Map>
+void push_table(HSQUIRRELVM vm, Map const& values)
+{
+  SQInteger const oldtop = sq_gettop(vm);
+  try {
+    sq_newtableex(vm, static_cast<SQInteger>(values.size()));
+    for (auto const& [key, value] : values) {
+      push_value(vm, key);
+      push_value(vm, value);
+      if (SQ_FAILED(sq_newslot(vm, -3, SQFalse))) {
+        throw SquirrelError::from_vm(vm, "failed to store table entry");
+      }
+    }
+  } catch (...) {
+    sq_settop(vm, oldtop);
+    throw;
+  }
+}
+
+} // namespace detail
+
+template<typename T, size_t Extent>
+void push_value(HSQUIRRELVM vm, std::span<T, Extent> values)
+{
+  detail::push_array(vm, values);
+}
+
+template<typename T, typename Alloc>
+void push_value(HSQUIRRELVM vm, std::vector<T, Alloc> const& values)
+{
+  detail::push_array(vm, values);
+}
+
+template<typename K, typename V, typename Compare, typename Alloc>
+void push_value(HSQUIRRELVM vm, std::map<K, V, Compare, Alloc> const& values)
+{
+  detail::push_table(vm, values);
+}
+
+template<typename K, typename V, typename Hash, typename KeyEqual, typename Alloc>
+void push_value(HSQUIRRELVM vm, std::unordered_map<K, V, Hash, KeyEqual, Alloc> const& values)
+{
+  detail::push_table(vm, values);
+}
+
+/** Serialize the closure on top of the stack, the closure stays on the stack */
 void write_closure(HSQUIRRELVM vm, std::ostream& out);
+
+/** Serialize the closure on top of the stack and append the bytecode to out */
+void write_closure(HSQUIRRELVM vm, std::vector<std::byte>& out);
+
+/** Deserialize a closure and push it on the stack */
 void read_closure(HSQUIRRELVM vm, std::istream& in);
 
+/** Deserialize a closure directly from data and push it on the
+    stack, returns the number of bytes consumed so that multiple
+    closures can be read back to back from the same buffer */
+size_t read_closure(HSQUIRRELVM vm, std::span<std::byte const> data);
+
 /** Convert the given index into a positive index (e.g. -1 -> sq_gettop()) */
 SQInteger absolute_index(HSQUIRRELVM vm, SQInteger idx);
 
+/** Iterate over the table, array or class at idx and call func() for
+    each entry with the key at -2 and the value at -1, func() must
+    leave the stack balanced */
+template<typename F>
+void for_each_entry(HSQUIRRELVM vm, SQInteger idx, F&& func)
+{
+  idx = absolute_index(vm, idx);
+
+  sq_pushnull(vm);  // iterator
+  while (SQ_SUCCEEDED(sq_next(vm, idx)))
+  {
+    func();
+    sq_pop(vm, 2);  // pops key and val before the next iteration
+  }
+  sq_pop(vm, 1);
+}
+
 TableContext new_table(HSQUIRRELVM vm);
 ArrayContext new_array(HSQUIRRELVM vm, SQInteger size = 0);
 
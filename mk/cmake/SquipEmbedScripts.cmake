@@ -0,0 +1,73 @@
+# squip - Squirrel Utility Library
+# Copyright (C) 2023 Ingo Ruhnke <grumbel@gmail.com>
+#
+# This software is provided 'as-is', without any express or implied
+# warranty.  In no event will the authors be held liable for any damages
+# arising from the use of this software.
+#
+# Permission is granted to anyone to use this software for any purpose,
+# including commercial applications, and to alter it and redistribute it
+# freely, subject to the following restrictions:
+#
+# 1. The origin of this software must not be misrepresented; you must not
+#    claim that you wrote the original software. If you use this software
+#    in a product, an acknowledgment in the product documentation would be
+#    appreciated but is not required.
+# 2. Altered source versions must be plainly marked as such, and must not be
+#    misrepresented as being the original software.
+# 3. This notice may not be removed or altered from any source distribution.
+
+# squip_embed_scripts(<target> FILES <file>... [BASE_DIR <dir>])
+#
+# Compile the given Squirrel scripts to bytecode at build time and
+# embed them into <target>. The scripts are registered under their
+# path relative to BASE_DIR (defaults to CMAKE_CURRENT_SOURCE_DIR) and
+# can be retrieved with squip::push_embedded_script(). The bytecode is
+# produced by the host squip_embed tool, so host and target must use
+# the same Squirrel build configuration. The tool runs in BASE_DIR, so
+# the source names compiled into the bytecode are the same relative
+# paths and no host paths end up in the binary.
+#
+# The scripts register themselves from a static initializer in a
+# generated source file. When <target> is a static library, nothing
+# references that object file and the linker drops it, so link the
+# library with whole-archive semantics (e.g. $<LINK_LIBRARY:WHOLE_ARCHIVE,...>)
+# or embed the scripts into the executable instead.
+function(squip_embed_scripts TARGET)
+  cmake_parse_arguments(ARG "" "BASE_DIR" "FILES" ${ARGN})
+
+  if(NOT ARG_BASE_DIR)
+    set(ARG_BASE_DIR "${CMAKE_CURRENT_SOURCE_DIR}")
+  endif()
+  get_filename_component(ARG_BASE_DIR "${ARG_BASE_DIR}" ABSOLUTE)
+
+  if(TARGET squip::squip_embed)
+    set(SQUIP_EMBED_TOOL squip::squip_embed)
+  elseif(TARGET squip_embed)
+    set(SQUIP_EMBED_TOOL squip_embed)
+  else()
+    message(FATAL_ERROR "squip_embed_scripts(): squip_embed tool not found")
+  endif()
+
+  set(INPUTS)
+  set(NAMES)
+  foreach(FILE ${ARG_FILES})
+    get_filename_component(FILE_ABSOLUTE "${FILE}" ABSOLUTE)
+    file(RELATIVE_PATH FILE_NAME "${ARG_BASE_DIR}" "${FILE_ABSOLUTE}")
+    list(APPEND INPUTS "${FILE_ABSOLUTE}")
+    list(APPEND NAMES "${FILE_NAME}")
+  endforeach()
+
+  set(OUTPUT "${CMAKE_CURRENT_BINARY_DIR}/${TARGET}_squip_embed.cpp")
+  add_custom_command(
+    OUTPUT "${OUTPUT}"
+    COMMAND ${SQUIP_EMBED_TOOL} --output "${OUTPUT}" ${NAMES}
+    WORKING_DIRECTORY "${ARG_BASE_DIR}"
+    DEPENDS ${SQUIP_EMBED_TOOL} ${INPUTS}
+    COMMENT "Embedding Squirrel scripts into ${TARGET}"
+    VERBATIM
+    )
+  target_sources(${TARGET} PRIVATE "${OUTPUT}")
+endfunction()
+
+# EOF #
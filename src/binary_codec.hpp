@@ -0,0 +1,357 @@
+// squip - Utilities for Squirrel
+// Copyright (C) 2023 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef HEADER_SQUIP_BINARY_CODEC_HPP
+#define HEADER_SQUIP_BINARY_CODEC_HPP
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <fmt/format.h>
+#include <squirrel.h>
+
+namespace squip {
+namespace detail {
+
+/* Building blocks shared by the table format of serialize.cpp and the
+   snapshot format of snapshot.cpp, not part of the public API.
+
+   All multi-byte values are little endian, varints are unsigned
+   LEB128 and integers are zigzag encoded. Strings are written once as
+   StringDef and afterwards referenced by their index in the order of
+   definition via StringRef. */
+
+enum class Tag : uint8_t
+{
+  Null = 0,
+  False = 1,
+  True = 2,
+  Integer = 3,
+  Float32 = 4,
+  Float64 = 5,
+  StringDef = 6,
+  StringRef = 7,
+  Table = 8,
+  Array = 9,
+
+  // snapshot only
+  Closure = 10,
+  Native = 11,
+  Class = 12,
+  Instance = 13,
+  ObjectRef = 14
+};
+
+class BinaryEncoder
+{
+public:
+  BinaryEncoder(std::vector<std::byte>& out) :
+    m_out(out),
+    m_strings()
+  {
+  }
+
+  void write_u8(uint8_t value)
+  {
+    m_out.push_back(static_cast<std::byte>(value));
+  }
+
+  void write_tag(Tag tag)
+  {
+    write_u8(static_cast<uint8_t>(tag));
+  }
+
+  void write_varint(uint64_t value)
+  {
+    while (value >= 0x80) {
+      write_u8(static_cast<uint8_t>(value | 0x80));
+      value >>= 7;
+    }
+    write_u8(static_cast<uint8_t>(value));
+  }
+
+  template<typename T>
+  void write_le(T value)
+  {
+    for (size_t i = 0; i < sizeof(T); ++i) {
+      write_u8(static_cast<uint8_t>(value >> (i * 8)));
+    }
+  }
+
+  /** Write size as varint followed by the data */
+  void write_bytes(void const* data, size_t size)
+  {
+    write_varint(size);
+    std::byte const* const bytes = static_cast<std::byte const*>(data);
+    m_out.insert(m_out.end(), bytes, bytes + size);
+  }
+
+  /** Write the null, bool, integer, float or string at idx, returns
+      false without writing anything for all other types */
+  bool write_primitive(HSQUIRRELVM vm, SQInteger idx)
+  {
+    switch (sq_gettype(vm, idx))
+    {
+      case OT_NULL:
+        write_tag(Tag::Null);
+        return true;
+
+      case OT_BOOL: {
+        SQBool val;
+        sq_getbool(vm, idx, &val);
+        write_tag(val ? Tag::True : Tag::False);
+        return true;
+      }
+
+      case OT_INTEGER: {
+        SQInteger val;
+        sq_getinteger(vm, idx, &val);
+        uint64_t const u = static_cast<uint64_t>(static_cast<int64_t>(val));
+        write_tag(Tag::Integer);
+        write_varint((u << 1) ^ (val < 0 ? ~uint64_t(0) : uint64_t(0)));
+        return true;
+      }
+
+      case OT_FLOAT: {
+        SQFloat val;
+        sq_getfloat(vm, idx, &val);
+        if constexpr (sizeof(SQFloat) == sizeof(float)) {
+          write_tag(Tag::Float32);
+          write_le(std::bit_cast<uint32_t>(static_cast<float>(val)));
+        } else {
+          write_tag(Tag::Float64);
+          write_le(std::bit_cast<uint64_t>(static_cast<double>(val)));
+        }
+        return true;
+      }
+
+      case OT_STRING:
+        write_string(vm, idx);
+        return true;
+
+      default:
+        return false;
+    }
+  }
+
+private:
+  void write_string(HSQUIRRELVM vm, SQInteger idx)
+  {
+    HSQOBJECT obj;
+    sq_getstackobj(vm, idx, &obj);
+
+    // Squirrel interns all strings, equal strings share the same object
+    auto const it = m_strings.find(obj._unVal.pRefCounted);
+    if (it != m_strings.end()) {
+      write_tag(Tag::StringRef);
+      write_varint(it->second);
+      return;
+    }
+
+    SQChar const* str;
+    SQInteger size;
+    sq_getstringandsize(vm, idx, &str, &size);
+
+    m_strings.emplace(obj._unVal.pRefCounted, m_strings.size());
+    write_tag(Tag::StringDef);
+    write_bytes(str, static_cast<size_t>(size) * sizeof(SQChar));
+  }
+
+private:
+  std::vector<std::byte>& m_out;
+
+  /** string object to index in the string table */
+  std::unordered_map<void const*, uint64_t> m_strings;
+
+public:
+  BinaryEncoder(BinaryEncoder const&) = delete;
+  BinaryEncoder& operator=(BinaryEncoder const&) = delete;
+};
+
+class BinaryDecoder
+{
+public:
+  /** context is the prefix of error messages */
+  BinaryDecoder(std::span<std::byte const> data, std::string_view context) :
+    m_context(context),
+    m_begin(data.data()),
+    m_p(data.data()),
+    m_end(data.data() + data.size()),
+    m_strings()
+  {
+  }
+
+  [[noreturn]] void error(std::string_view message) const
+  {
+    throw std::runtime_error(fmt::format("{}: {} at offset {}",
+                                         m_context, message, m_p - m_begin));
+  }
+
+  /** Number of bytes consumed so far */
+  size_t get_offset() const { return static_cast<size_t>(m_p - m_begin); }
+  bool at_end() const { return m_p == m_end; }
+
+  uint8_t read_u8()
+  {
+    if (m_p == m_end) {
+      error("unexpected end of data");
+    }
+    return static_cast<uint8_t>(*m_p++);
+  }
+
+  Tag read_tag()
+  {
+    return static_cast<Tag>(read_u8());
+  }
+
+  uint64_t read_varint()
+  {
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      uint8_t const byte = read_u8();
+      result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0) {
+        return result;
+      }
+    }
+    error("invalid varint");
+  }
+
+  /** Element count, every element takes at least one byte */
+  SQInteger read_count()
+  {
+    uint64_t const count = read_varint();
+    if (count > static_cast<uint64_t>(m_end - m_p)) {
+      error("invalid element count");
+    }
+    return static_cast<SQInteger>(count);
+  }
+
+  template<typename T>
+  T read_le()
+  {
+    if (static_cast<size_t>(m_end - m_p) < sizeof(T)) {
+      error("unexpected end of data");
+    }
+
+    T result = 0;
+    for (size_t i = 0; i < sizeof(T); ++i) {
+      result |= static_cast<T>(static_cast<T>(*m_p++) << (i * 8));
+    }
+    return result;
+  }
+
+  /** Read data written by BinaryEncoder::write_bytes() */
+  std::span<std::byte const> read_bytes()
+  {
+    uint64_t const size = read_varint();
+    if (size > static_cast<uint64_t>(m_end - m_p)) {
+      error("unexpected end of data");
+    }
+    std::span<std::byte const> const result(m_p, static_cast<size_t>(size));
+    m_p += size;
+    return result;
+  }
+
+  /** Push the value of a null, bool, integer, float or string tag,
+      returns false without reading anything for all other tags.
+      Strings are kept alive by appending them to the array at
+      pool_idx. */
+  bool push_primitive(HSQUIRRELVM vm, Tag tag, SQInteger pool_idx)
+  {
+    switch (tag)
+    {
+      case Tag::Null:
+        sq_pushnull(vm);
+        return true;
+
+      case Tag::False:
+        sq_pushbool(vm, SQFalse);
+        return true;
+
+      case Tag::True:
+        sq_pushbool(vm, SQTrue);
+        return true;
+
+      case Tag::Integer: {
+        uint64_t const u = read_varint();
+        int64_t const val = static_cast<int64_t>(u >> 1) ^ -static_cast<int64_t>(u & 1);
+        sq_pushinteger(vm, static_cast<SQInteger>(val));
+        return true;
+      }
+
+      case Tag::Float32:
+        sq_pushfloat(vm, static_cast<SQFloat>(std::bit_cast<float>(read_le<uint32_t>())));
+        return true;
+
+      case Tag::Float64:
+        sq_pushfloat(vm, static_cast<SQFloat>(std::bit_cast<double>(read_le<uint64_t>())));
+        return true;
+
+      case Tag::StringDef: {
+        std::span<std::byte const> const str = read_bytes();
+        sq_pushstring(vm, reinterpret_cast<SQChar const*>(str.data()),
+                      static_cast<SQInteger>(str.size() / sizeof(SQChar)));
+
+        HSQOBJECT obj;
+        sq_getstackobj(vm, -1, &obj);
+        m_strings.push_back(obj);
+
+        sq_push(vm, -1);
+        sq_arrayappend(vm, pool_idx);
+        return true;
+      }
+
+      case Tag::StringRef: {
+        uint64_t const index = read_varint();
+        if (index >= m_strings.size()) {
+          error("invalid string reference");
+        }
+        sq_pushobject(vm, m_strings[index]);
+        return true;
+      }
+
+      default:
+        return false;
+    }
+  }
+
+private:
+  std::string_view m_context;
+  std::byte const* m_begin;
+  std::byte const* m_p;
+  std::byte const* m_end;
+
+  /** strings in the order of their StringDef, kept alive by the pool */
+  std::vector<HSQOBJECT> m_strings;
+
+public:
+  BinaryDecoder(BinaryDecoder const&) = delete;
+  BinaryDecoder& operator=(BinaryDecoder const&) = delete;
+};
+
+} // namespace detail
+} // namespace squip
+
+#endif
+
+/* EOF */
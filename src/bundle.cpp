@@ -0,0 +1,257 @@
+// squip - Utilities for Squirrel
+// Copyright (C) 2023 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "squip/bundle.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+#include "squip/squirrel_error.hpp"
+#include "squip/util.hpp"
+
+namespace squip {
+
+namespace {
+
+/* File layout, all values in native byte order:
+
+     BundleHeader
+     closure bytecode, back to back
+     padding to 8 bytes
+     IndexEntry[entry_count], sorted by name
+     names, back to back
+*/
+
+constexpr char bundle_magic[4] = { 'S', 'Q', 'P', 'B' };
+constexpr uint32_t bundle_format_version = 1;
+
+struct BundleHeader
+{
+  char magic[4];
+  uint32_t format_version;
+  int64_t squirrel_version;
+  uint8_t char_size;
+  uint8_t integer_size;
+  uint8_t float_size;
+  uint8_t padding[5];
+  uint64_t entry_count;
+  uint64_t index_offset;
+};
+
+BundleHeader make_header(uint64_t entry_count, uint64_t index_offset)
+{
+  BundleHeader header{};
+  std::memcpy(header.magic, bundle_magic, sizeof(bundle_magic));
+  header.format_version = bundle_format_version;
+  header.squirrel_version = sq_getversion();
+  header.char_size = sizeof(SQChar);
+  header.integer_size = sizeof(SQInteger);
+  header.float_size = sizeof(SQFloat);
+  header.entry_count = entry_count;
+  header.index_offset = index_offset;
+  return header;
+}
+
+} // namespace
+
+Bundle::Bundle(std::filesystem::path const& path) :
+  m_path(path),
+  m_file(path),
+  m_count(0),
+  m_index_offset(0),
+  m_closures()
+{
+  std::span<std::byte const> const data = m_file.get_data();
+
+  BundleHeader header;
+  if (data.size() < sizeof(header)) {
+    throw std::runtime_error(fmt::format("{}: not a squip bundle", m_path.string()));
+  }
+  std::memcpy(&header, data.data(), sizeof(header));
+
+  BundleHeader const expected = make_header(header.entry_count, header.index_offset);
+  if (std::memcmp(&header, &expected, sizeof(header)) != 0) {
+    throw std::runtime_error(fmt::format("{}: not a squip bundle or built for an incompatible Squirrel",
+                                         m_path.string()));
+  }
+
+  if (header.index_offset > data.size() ||
+      header.entry_count > (data.size() - header.index_offset) / sizeof(IndexEntry)) {
+    throw std::runtime_error(fmt::format("{}: corrupt bundle index", m_path.string()));
+  }
+
+  m_count = header.entry_count;
+  m_index_offset = header.index_offset;
+  m_closures.resize(m_count);
+}
+
+Bundle::~Bundle()
+{
+}
+
+bool
+Bundle::contains(std::string_view name) const
+{
+  return find(name).has_value();
+}
+
+std::vector<std::string_view>
+Bundle::get_names() const
+{
+  std::vector<std::string_view> names;
+  names.reserve(m_count);
+  for (size_t i = 0; i < m_count; ++i) {
+    names.emplace_back(get_name(get_entry(i)));
+  }
+  return names;
+}
+
+void
+Bundle::push_closure(HSQUIRRELVM vm, std::string_view name)
+{
+  std::optional<size_t> const idx = find(name);
+  if (!idx) {
+    throw std::runtime_error(fmt::format("{}: no entry '{}' in bundle", m_path.string(), name));
+  }
+
+  Object& closure = m_closures[*idx];
+  if (closure.get_type() != OT_CLOSURE) {
+    IndexEntry const entry = get_entry(*idx);
+    std::span<std::byte const> const data = m_file.get_data();
+    if (entry.data_offset > data.size() || entry.data_size > data.size() - entry.data_offset) {
+      throw std::runtime_error(fmt::format("{}: corrupt bundle entry '{}'", m_path.string(), name));
+    }
+
+    read_closure(vm, data.subspan(entry.data_offset, entry.data_size));
+    closure = Object(vm, -1);
+  } else {
+    closure.push(vm);
+  }
+}
+
+Bundle::IndexEntry
+Bundle::get_entry(size_t idx) const
+{
+  IndexEntry entry;
+  std::memcpy(&entry, m_file.get_data().data() + m_index_offset + idx * sizeof(IndexEntry), sizeof(entry));
+  return entry;
+}
+
+std::string_view
+Bundle::get_name(IndexEntry const& entry) const
+{
+  std::string_view const text = m_file.get_text();
+  if (entry.name_offset > text.size() || entry.name_size > text.size() - entry.name_offset) {
+    throw std::runtime_error(fmt::format("{}: corrupt bundle index", m_path.string()));
+  }
+  return text.substr(entry.name_offset, entry.name_size);
+}
+
+std::optional<size_t>
+Bundle::find(std::string_view name) const
+{
+  // binary search directly on the mapped index
+  size_t lo = 0;
+  size_t hi = m_count;
+  while (lo < hi) {
+    size_t const mid = lo + (hi - lo) / 2;
+    int const cmp = get_name(get_entry(mid)).compare(name);
+    if (cmp == 0) {
+      return mid;
+    } else if (cmp < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return std::nullopt;
+}
+
+BundleWriter::BundleWriter() :
+  m_entries()
+{
+}
+
+BundleWriter::~BundleWriter()
+{
+}
+
+void
+BundleWriter::add_closure(HSQUIRRELVM vm, std::string_view name)
+{
+  std::vector<std::byte> bytecode;
+  write_closure(vm, bytecode);
+  add_bytecode(name, std::move(bytecode));
+}
+
+void
+BundleWriter::add_bytecode(std::string_view name, std::vector<std::byte> bytecode)
+{
+  m_entries.insert_or_assign(std::string(name), std::move(bytecode));
+}
+
+void
+BundleWriter::write(std::filesystem::path const& path) const
+{
+  std::vector<Bundle::IndexEntry> index;
+  index.reserve(m_entries.size());
+
+  uint64_t offset = sizeof(BundleHeader);
+  for (auto const& [name, bytecode] : m_entries) {
+    index.push_back({0, name.size(), offset, bytecode.size()});
+    offset += bytecode.size();
+  }
+
+  uint64_t const padding = (8 - offset % 8) % 8;
+  uint64_t const index_offset = offset + padding;
+
+  uint64_t name_offset = index_offset + index.size() * sizeof(Bundle::IndexEntry);
+  for (auto& entry : index) {
+    entry.name_offset = name_offset;
+    name_offset += entry.name_size;
+  }
+
+  std::ofstream fout(path, std::ios::binary | std::ios::trunc);
+  if (!fout) {
+    throw std::runtime_error(fmt::format("failed to open file: {}", path.string()));
+  }
+
+  BundleHeader const header = make_header(index.size(), index_offset);
+  fout.write(reinterpret_cast<char const*>(&header), sizeof(header));
+  for (auto const& [name, bytecode] : m_entries) {
+    fout.write(reinterpret_cast<char const*>(bytecode.data()), static_cast<std::streamsize>(bytecode.size()));
+  }
+  char const zeros[8] = {};
+  fout.write(zeros, static_cast<std::streamsize>(padding));
+  fout.write(reinterpret_cast<char const*>(index.data()),
+             static_cast<std::streamsize>(index.size() * sizeof(Bundle::IndexEntry)));
+  for (auto const& [name, bytecode] : m_entries) {
+    fout.write(name.data(), static_cast<std::streamsize>(name.size()));
+  }
+
+  fout.close();
+  if (!fout) {
+    throw std::runtime_error(fmt::format("failed to write file: {}", path.string()));
+  }
+}
+
+} // namespace squip
+
+/* EOF */
@@ -0,0 +1,80 @@
+// squip - Utilities for Squirrel
+// Copyright (C) 2023 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "squip/embedded_scripts.hpp"
+
+#include <functional>
+#include <map>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+#include "squip/util.hpp"
+
+namespace squip {
+
+namespace {
+
+using EmbeddedScriptRegistry = std::map<std::string_view, std::span<std::byte const>, std::less<>>;
+
+// function local static as registration happens during static initialization
+EmbeddedScriptRegistry& get_registry()
+{
+  static EmbeddedScriptRegistry registry;
+  return registry;
+}
+
+} // namespace
+
+void register_embedded_script(std::string_view name, std::span<std::byte const> bytecode)
+{
+  get_registry().insert_or_assign(name, bytecode);
+}
+
+std::optional<std::span<std::byte const>> find_embedded_script(std::string_view name)
+{
+  EmbeddedScriptRegistry const& registry = get_registry();
+  auto const it = registry.find(name);
+  if (it == registry.end()) {
+    return std::nullopt;
+  }
+  return it->second;
+}
+
+std::vector<std::string_view> get_embedded_script_names()
+{
+  EmbeddedScriptRegistry const& registry = get_registry();
+
+  std::vector<std::string_view> names;
+  names.reserve(registry.size());
+  for (auto const& [name, bytecode] : registry) {
+    names.emplace_back(name);
+  }
+  return names;
+}
+
+void push_embedded_script(HSQUIRRELVM vm, std::string_view name)
+{
+  std::optional<std::span<std::byte const>> const bytecode = find_embedded_script(name);
+  if (!bytecode) {
+    throw std::runtime_error(fmt::format("no embedded script: {}", name));
+  }
+  read_closure(vm, *bytecode);
+}
+
+} // namespace squip
+
+/* EOF */
@@ -0,0 +1,103 @@
+// squip - Utilities for Squirrel
+// Copyright (C) 2023 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "squip/eval_cache.hpp"
+
+#include <cassert>
+
+#include "squip/squirrel_vm.hpp"
+#include "squip/util.hpp"
+
+namespace squip {
+
+EvalCache::EvalCache(SquirrelVM& sqvm, size_t capacity) :
+  m_sqvm(sqvm),
+  m_capacity(capacity),
+  m_entries(),
+  m_index(),
+  m_hits(0),
+  m_misses(0)
+{
+  assert(m_capacity > 0);
+}
+
+EvalCache::~EvalCache()
+{
+  clear();
+}
+
+void
+EvalCache::compile_buffer(HSQUIRRELVM vm, std::string_view source,
+                          const std::string& sourcename)
+{
+  auto const it = m_index.find(source);
+  if (it != m_index.end()) {
+    // the sourcename is part of the compiled closure, so it has to match as well
+    if (it->second->sourcename == sourcename) {
+      m_hits += 1;
+      m_entries.splice(m_entries.begin(), m_entries, it->second);
+      sq_pushobject(vm, it->second->closure);
+      return;
+    }
+
+    evict(it->second);
+  }
+
+  m_misses += 1;
+  squip::compile_buffer(vm, source, sourcename);
+
+  HSQOBJECT closure;
+  sq_resetobject(&closure);
+  sq_getstackobj(vm, -1, &closure);
+  sq_addref(m_sqvm.get_vm(), &closure);
+
+  m_entries.push_front(Entry{std::string(source), sourcename, closure});
+  m_index.emplace(m_entries.front().source, m_entries.begin());
+
+  if (m_entries.size() > m_capacity) {
+    evict(std::prev(m_entries.end()));
+  }
+}
+
+void
+EvalCache::compile_and_run(HSQUIRRELVM vm, std::string_view source,
+                           const std::string& sourcename)
+{
+  compile_buffer(vm, source, sourcename);
+  run_closure(vm, sourcename);
+}
+
+void
+EvalCache::clear()
+{
+  for (auto& entry : m_entries) {
+    sq_release(m_sqvm.get_vm(), &entry.closure);
+  }
+  m_index.clear();
+  m_entries.clear();
+}
+
+void
+EvalCache::evict(std::list<Entry>::iterator it)
+{
+  sq_release(m_sqvm.get_vm(), &it->closure);
+  m_index.erase(it->source);
+  m_entries.erase(it);
+}
+
+} // namespace squip
+
+/* EOF */
@@ -0,0 +1,112 @@
+// squip - Utilities for Squirrel
+// Copyright (C) 2023 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "squip/field_ref.hpp"
+
+#include <fmt/format.h>
+
+#include "squip/squirrel_error.hpp"
+
+namespace squip {
+
+FieldRef::FieldRef(HSQUIRRELVM vm, SQInteger idx, std::string_view name) :
+  m_name(name),
+  m_handle(),
+  m_class()
+{
+  idx = absolute_index(vm, idx);
+
+  sq_pushstring(vm, name.data(), static_cast<SQInteger>(name.size()));
+  if (SQ_FAILED(sq_getmemberhandle(vm, idx, &m_handle))) {
+    sq_poptop(vm);
+    throw SquirrelError::from_vm(vm, fmt::format("failed to get member handle for '{}'", name));
+  }
+
+  m_class = Object(vm, idx);
+}
+
+void
+FieldRef::push(HSQUIRRELVM vm, SQInteger idx) const
+{
+  check_class(vm, idx);
+
+  if (SQ_FAILED(sq_getbyhandle(vm, idx, &m_handle))) {
+    throw SquirrelError::from_vm(vm, fmt::format("failed to get member '{}'", m_name));
+  }
+}
+
+void
+FieldRef::pop(HSQUIRRELVM vm, SQInteger idx) const
+{
+  idx = absolute_index(vm, idx);
+
+  try {
+    check_class(vm, idx);
+  } catch (...) {
+    sq_poptop(vm);
+    throw;
+  }
+
+  if (SQ_FAILED(sq_setbyhandle(vm, idx, &m_handle))) {
+    sq_poptop(vm);
+    throw SquirrelError::from_vm(vm, fmt::format("failed to set member '{}'", m_name));
+  }
+}
+
+void
+FieldRef::check_class(HSQUIRRELVM vm, SQInteger idx) const
+{
+  idx = absolute_index(vm, idx);
+
+  bool matches = false;
+  switch (sq_gettype(vm, idx))
+  {
+    case OT_INSTANCE:
+      sq_push(vm, idx);
+      sq_pushobject(vm, m_class.get_handle());
+      matches = sq_instanceof(vm) != SQFalse;
+      sq_pop(vm, 2);
+      break;
+
+    case OT_CLASS: {
+      // walk the base classes, the first match wins
+      sq_push(vm, idx);
+      while (sq_gettype(vm, -1) == OT_CLASS) {
+        HSQOBJECT cls;
+        sq_getstackobj(vm, -1, &cls);
+        if (cls._unVal.pClass == m_class.get_handle()._unVal.pClass) {
+          matches = true;
+          break;
+        }
+        sq_getbase(vm, -1);
+        sq_remove(vm, -2);
+      }
+      sq_poptop(vm);
+      break;
+    }
+
+    default:
+      break;
+  }
+
+  if (!matches) {
+    throw SquirrelError::from_vm(vm, fmt::format("member handle for '{}' used on an unrelated object", m_name));
+  }
+}
+
+} // namespace squip
+
+/* EOF */
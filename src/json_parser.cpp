@@ -0,0 +1,549 @@
+// squip - Utilities for Squirrel
+// Copyright (C) 2023 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "squip/json_parser.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+#include <fmt/format.h>
+
+#include "squip/table_context.hpp"
+#include "squip/unpack.hpp"
+
+namespace squip {
+
+namespace {
+
+/** guards the native stack against deeply nested documents */
+constexpr int max_depth = 1024;
+
+/** upper bound for the number of distinct keys kept referenced */
+constexpr size_t max_interned_keys = 4096;
+
+bool is_digit(char c)
+{
+  return '0' <= c && c <= '9';
+}
+
+int hex_value(char c)
+{
+  if ('0' <= c && c <= '9') {
+    return c - '0';
+  } else if ('a' <= c && c <= 'f') {
+    return c - 'a' + 10;
+  } else if ('A' <= c && c <= 'F') {
+    return c - 'A' + 10;
+  } else {
+    return -1;
+  }
+}
+
+void append_utf8(std::string& out, uint32_t codepoint)
+{
+  if (codepoint < 0x80) {
+    out += static_cast<char>(codepoint);
+  } else if (codepoint < 0x800) {
+    out += static_cast<char>(0xc0 | (codepoint >> 6));
+    out += static_cast<char>(0x80 | (codepoint & 0x3f));
+  } else if (codepoint < 0x10000) {
+    out += static_cast<char>(0xe0 | (codepoint >> 12));
+    out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3f));
+    out += static_cast<char>(0x80 | (codepoint & 0x3f));
+  } else {
+    out += static_cast<char>(0xf0 | (codepoint >> 18));
+    out += static_cast<char>(0x80 | ((codepoint >> 12) & 0x3f));
+    out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3f));
+    out += static_cast<char>(0x80 | (codepoint & 0x3f));
+  }
+}
+
+class JsonParser
+{
+public:
+  JsonParser(HSQUIRRELVM vm, std::string_view text) :
+    m_vm(vm),
+    m_begin(text.data()),
+    m_p(text.data()),
+    m_end(text.data() + text.size()),
+    m_reserved_top(0),
+    m_depth(0),
+    m_scratch(),
+    m_keys()
+  {
+  }
+
+  ~JsonParser()
+  {
+    for (auto& it : m_keys) {
+      sq_release(m_vm, &it.second);
+    }
+  }
+
+  void parse()
+  {
+    skip_whitespace();
+    parse_value();
+    skip_whitespace();
+    if (m_p != m_end) {
+      error("unexpected trailing characters");
+    }
+  }
+
+private:
+  [[noreturn]] void error(std::string_view message) const
+  {
+    int line = 1;
+    int column = 1;
+    for (char const* p = m_begin; p != m_p; ++p) {
+      if (*p == '\n') {
+        line += 1;
+        column = 1;
+      } else {
+        column += 1;
+      }
+    }
+    throw std::runtime_error(fmt::format("parse_json: {} at line {}, column {}", message, line, column));
+  }
+
+  /** Squirrel doesn't grow the stack on push, so make room for count
+      more values, growing geometrically */
+  void reserve_stack(SQInteger count)
+  {
+    SQInteger const top = sq_gettop(m_vm);
+    if (top + count > m_reserved_top) {
+      SQInteger const grow = std::max(count, top);
+      if (SQ_FAILED(sq_reservestack(m_vm, grow))) {
+        error("failed to grow the stack");
+      }
+      m_reserved_top = top + grow;
+    }
+  }
+
+  void enter()
+  {
+    if (++m_depth > max_depth) {
+      error("nesting too deep");
+    }
+  }
+
+  /** Replace the elements above base with the container on top of the stack */
+  void collapse(SQInteger base)
+  {
+    HSQOBJECT obj;
+    sq_getstackobj(m_vm, -1, &obj);
+    sq_addref(m_vm, &obj);
+    sq_settop(m_vm, base);
+    sq_pushobject(m_vm, obj);
+    sq_release(m_vm, &obj);
+
+    m_depth -= 1;
+  }
+
+  void skip_whitespace()
+  {
+    while (m_p != m_end && (*m_p == ' ' || *m_p == '\n' || *m_p == '\r' || *m_p == '\t')) {
+      ++m_p;
+    }
+  }
+
+  /** Consume c or fail */
+  void expect(char c, std::string_view message)
+  {
+    if (m_p == m_end || *m_p != c) {
+      error(message);
+    }
+    ++m_p;
+  }
+
+  void expect_literal(std::string_view literal)
+  {
+    if (static_cast<size_t>(m_end - m_p) < literal.size() ||
+        std::string_view(m_p, literal.size()) != literal) {
+      error("invalid literal");
+    }
+    m_p += literal.size();
+  }
+
+  void parse_value()
+  {
+    if (m_p == m_end) {
+      error("unexpected end of input");
+    }
+
+    reserve_stack(1);
+    switch (*m_p)
+    {
+      case '{':
+        parse_object();
+        break;
+
+      case '[':
+        parse_array();
+        break;
+
+      case '"':
+        parse_string(false);
+        break;
+
+      case 't':
+        expect_literal("true");
+        sq_pushbool(m_vm, SQTrue);
+        break;
+
+      case 'f':
+        expect_literal("false");
+        sq_pushbool(m_vm, SQFalse);
+        break;
+
+      case 'n':
+        expect_literal("null");
+        sq_pushnull(m_vm);
+        break;
+
+      default:
+        parse_number();
+        break;
+    }
+  }
+
+  void parse_array()
+  {
+    ++m_p;
+    enter();
+
+    SQInteger const base = sq_gettop(m_vm);
+    skip_whitespace();
+    if (m_p != m_end && *m_p == ']') {
+      ++m_p;
+    } else {
+      while (true) {
+        skip_whitespace();
+        parse_value();
+        skip_whitespace();
+        if (m_p != m_end && *m_p == ',') {
+          ++m_p;
+        } else {
+          expect(']', "expected ',' or ']'");
+          break;
+        }
+      }
+    }
+
+    SQInteger const count = sq_gettop(m_vm) - base;
+    reserve_stack(3);
+    sq_newarray(m_vm, count);
+    for (SQInteger i = 0; i < count; ++i) {
+      sq_pushinteger(m_vm, i);
+      sq_push(m_vm, base + 1 + i);
+      sq_set(m_vm, -3);
+    }
+    collapse(base);
+  }
+
+  void parse_object()
+  {
+    ++m_p;
+    enter();
+
+    SQInteger const base = sq_gettop(m_vm);
+    skip_whitespace();
+    if (m_p != m_end && *m_p == '}') {
+      ++m_p;
+    } else {
+      while (true) {
+        skip_whitespace();
+        if (m_p == m_end || *m_p != '"') {
+          error("expected string key");
+        }
+        reserve_stack(1);
+        parse_string(true);
+        skip_whitespace();
+        expect(':', "expected ':'");
+        skip_whitespace();
+        parse_value();
+        skip_whitespace();
+        if (m_p != m_end && *m_p == ',') {
+          ++m_p;
+        } else {
+          expect('}', "expected ',' or '}'");
+          break;
+        }
+      }
+    }
+
+    SQInteger const count = (sq_gettop(m_vm) - base) / 2;
+    reserve_stack(3);
+    sq_newtableex(m_vm, count);
+    for (SQInteger i = 0; i < count; ++i) {
+      sq_push(m_vm, base + 1 + 2 * i);
+      sq_push(m_vm, base + 2 + 2 * i);
+      sq_newslot(m_vm, -3, SQFalse);
+    }
+    collapse(base);
+  }
+
+  void parse_string(bool is_key)
+  {
+    ++m_p;
+
+    // fast path, strings without escapes are pushed straight from the input
+    char const* const start = m_p;
+    while (m_p != m_end && *m_p != '"' && *m_p != '\\') {
+      if (static_cast<unsigned char>(*m_p) < 0x20) {
+        error("control character in string");
+      }
+      ++m_p;
+    }
+
+    std::string_view str;
+    if (m_p != m_end && *m_p == '"') {
+      str = std::string_view(start, static_cast<size_t>(m_p - start));
+      ++m_p;
+    } else {
+      m_scratch.assign(start, m_p);
+      parse_escaped_string();
+      str = m_scratch;
+    }
+
+    if (is_key) {
+      push_key(str);
+    } else {
+      sq_pushstring(m_vm, str.data(), static_cast<SQInteger>(str.size()));
+    }
+  }
+
+  /** Decode the remainder of a string into m_scratch */
+  void parse_escaped_string()
+  {
+    while (true) {
+      if (m_p == m_end) {
+        error("unterminated string");
+      }
+
+      char const c = *m_p++;
+      if (c == '"') {
+        return;
+      } else if (static_cast<unsigned char>(c) < 0x20) {
+        error("control character in string");
+      } else if (c != '\\') {
+        m_scratch += c;
+      } else {
+        if (m_p == m_end) {
+          error("unterminated string");
+        }
+
+        switch (*m_p++) {
+          case '"': m_scratch += '"'; break;
+          case '\\': m_scratch += '\\'; break;
+          case '/': m_scratch += '/'; break;
+          case 'b': m_scratch += '\b'; break;
+          case 'f': m_scratch += '\f'; break;
+          case 'n': m_scratch += '\n'; break;
+          case 'r': m_scratch += '\r'; break;
+          case 't': m_scratch += '\t'; break;
+
+          case 'u': {
+            uint32_t codepoint = parse_hex4();
+            if (0xd800 <= codepoint && codepoint <= 0xdbff) {
+              if (m_end - m_p < 2 || m_p[0] != '\\' || m_p[1] != 'u') {
+                error("unpaired surrogate");
+              }
+              m_p += 2;
+              uint32_t const low = parse_hex4();
+              if (low < 0xdc00 || 0xdfff < low) {
+                error("unpaired surrogate");
+              }
+              codepoint = 0x10000 + ((codepoint - 0xd800) << 10) + (low - 0xdc00);
+            } else if (0xdc00 <= codepoint && codepoint <= 0xdfff) {
+              error("unpaired surrogate");
+            }
+            append_utf8(m_scratch, codepoint);
+            break;
+          }
+
+          default:
+            error("invalid escape sequence");
+        }
+      }
+    }
+  }
+
+  uint32_t parse_hex4()
+  {
+    if (m_end - m_p < 4) {
+      error("invalid unicode escape");
+    }
+
+    uint32_t result = 0;
+    for (int i = 0; i < 4; ++i) {
+      int const digit = hex_value(*m_p++);
+      if (digit < 0) {
+        error("invalid unicode escape");
+      }
+      result = (result << 4) | static_cast<uint32_t>(digit);
+    }
+    return result;
+  }
+
+  /** Push an object key, keys seen before are pushed from the
+      interned handle without rehashing them in the VM */
+  void push_key(std::string_view str)
+  {
+    auto const it = m_keys.find(str);
+    if (it != m_keys.end()) {
+      sq_pushobject(m_vm, it->second);
+      return;
+    }
+
+    sq_pushstring(m_vm, str.data(), static_cast<SQInteger>(str.size()));
+    if (m_keys.size() < max_interned_keys) {
+      HSQOBJECT obj;
+      sq_getstackobj(m_vm, -1, &obj);
+      sq_addref(m_vm, &obj);
+
+      // the view points into the Squirrel string, which the reference keeps alive
+      SQChar const* data;
+      SQInteger size;
+      sq_getstringandsize(m_vm, -1, &data, &size);
+      m_keys.emplace(std::string_view(data, static_cast<size_t>(size)), obj);
+    }
+  }
+
+  void parse_number()
+  {
+    char const* const start = m_p;
+    bool is_float = false;
+
+    if (*m_p == '-') {
+      ++m_p;
+    }
+
+    if (m_p == m_end || !is_digit(*m_p)) {
+      error("invalid value");
+    }
+
+    if (*m_p == '0') {
+      ++m_p;
+    } else {
+      skip_digits();
+    }
+
+    if (m_p != m_end && *m_p == '.') {
+      is_float = true;
+      ++m_p;
+      expect_digit();
+      skip_digits();
+    }
+
+    if (m_p != m_end && (*m_p == 'e' || *m_p == 'E')) {
+      is_float = true;
+      ++m_p;
+      if (m_p != m_end && (*m_p == '+' || *m_p == '-')) {
+        ++m_p;
+      }
+      expect_digit();
+      skip_digits();
+    }
+
+    if (!is_float) {
+      SQInteger value;
+      std::from_chars_result const result = std::from_chars(start, m_p, value);
+      if (result.ec == std::errc()) {
+        sq_pushinteger(m_vm, value);
+        return;
+      }
+      // too large for SQInteger, fall back to float
+    }
+
+    double value;
+    std::from_chars_result const result = std::from_chars(start, m_p, value);
+    if (result.ec != std::errc()) {
+      error("number out of range");
+    }
+    sq_pushfloat(m_vm, static_cast<SQFloat>(value));
+  }
+
+  void expect_digit()
+  {
+    if (m_p == m_end || !is_digit(*m_p)) {
+      error("invalid number");
+    }
+  }
+
+  void skip_digits()
+  {
+    while (m_p != m_end && is_digit(*m_p)) {
+      ++m_p;
+    }
+  }
+
+private:
+  HSQUIRRELVM m_vm;
+  char const* m_begin;
+  char const* m_p;
+  char const* m_end;
+
+  SQInteger m_reserved_top;
+  int m_depth;
+
+  /** buffer for strings that contain escape sequences */
+  std::string m_scratch;
+
+  /** keys point into the referenced Squirrel strings */
+  std::unordered_map<std::string_view, HSQOBJECT> m_keys;
+
+public:
+  JsonParser(JsonParser const&) = delete;
+  JsonParser& operator=(JsonParser const&) = delete;
+};
+
+SQInteger parse_json_native(HSQUIRRELVM vm)
+{
+  try {
+    parse_json(vm, unpack<std::string_view>(vm, 2));
+    return 1;
+  } catch (std::exception const& err) {
+    return sq_throwerror(vm, err.what());
+  }
+}
+
+} // namespace
+
+void parse_json(HSQUIRRELVM vm, std::string_view text)
+{
+  SQInteger const oldtop = sq_gettop(vm);
+  try {
+    JsonParser parser(vm, text);
+    parser.parse();
+  } catch (...) {
+    sq_settop(vm, oldtop);
+    throw;
+  }
+}
+
+void register_json_parser(TableContext& table)
+{
+  table.store_c_function("parse_json", ".s", &parse_json_native);
+}
+
+} // namespace squip
+
+/* EOF */
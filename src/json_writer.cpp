@@ -0,0 +1,332 @@
+// squip - Utilities for Squirrel
+// Copyright (C) 2023 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "squip/json_writer.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#include <unistd.h>
+
+#include "squip/stack_guard.hpp"
+#include "squip/util.hpp"
+
+namespace squip {
+
+namespace {
+
+/** Returns the short escape sequence for c, nullptr if c can be
+    written as is and an empty string if it needs a \u escape */
+char const* json_escape_sequence(char c)
+{
+  switch (c) {
+    case '"': return "\\\"";
+    case '\\': return "\\\\";
+    case '\b': return "\\b";
+    case '\f': return "\\f";
+    case '\n': return "\\n";
+    case '\r': return "\\r";
+    case '\t': return "\\t";
+    default:
+      if (static_cast<unsigned char>(c) < 0x20) {
+        return "";
+      } else {
+        return nullptr;
+      }
+  }
+}
+
+} // namespace
+
+JsonWriter::Sink
+JsonWriter::fd_sink(int fd)
+{
+  return [fd](std::string_view data) {
+    while (!data.empty()) {
+      ssize_t const ret = ::write(fd, data.data(), data.size());
+      if (ret < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        throw std::runtime_error(fmt::format("JsonWriter: write failed: {}", strerror(errno)));
+      }
+      data.remove_prefix(static_cast<size_t>(ret));
+    }
+  };
+}
+
+JsonWriter::JsonWriter(Sink sink, bool pretty, size_t chunk_size) :
+  m_sink(std::move(sink)),
+  m_pretty(pretty),
+  m_chunk_size(chunk_size),
+  m_buffer(),
+  m_path()
+{
+}
+
+JsonWriter::~JsonWriter()
+{
+}
+
+void
+JsonWriter::write(HSQUIRRELVM vm, SQInteger idx)
+{
+  StackGuard guard(vm);
+
+  m_path.clear();
+  try {
+    write_value(vm, absolute_index(vm, idx), 0);
+  } catch (...) {
+    // chunks handed to the sink by maybe_flush() can't be taken back,
+    // only drop what is still buffered, the sink is left with a
+    // truncated document
+    m_buffer.clear();
+    throw;
+  }
+
+  if (m_pretty) {
+    m_buffer.push_back('\n');
+  }
+  flush();
+}
+
+void
+JsonWriter::flush()
+{
+  if (m_buffer.size() != 0) {
+    m_sink(std::string_view(m_buffer.data(), m_buffer.size()));
+    m_buffer.clear();
+  }
+}
+
+void
+JsonWriter::maybe_flush()
+{
+  if (m_buffer.size() >= m_chunk_size) {
+    flush();
+  }
+}
+
+void
+JsonWriter::write_value(HSQUIRRELVM vm, SQInteger idx, int indent)
+{
+  switch (sq_gettype(vm, idx))
+  {
+    case OT_NULL:
+      m_buffer.append(std::string_view("null"));
+      break;
+
+    case OT_BOOL: {
+      SQBool val;
+      sq_getbool(vm, idx, &val);
+      m_buffer.append(val ? std::string_view("true") : std::string_view("false"));
+      break;
+    }
+
+    case OT_INTEGER: {
+      SQInteger val;
+      sq_getinteger(vm, idx, &val);
+      detail::append_number(m_buffer, val);
+      break;
+    }
+
+    case OT_FLOAT: {
+      SQFloat val;
+      sq_getfloat(vm, idx, &val);
+      if (std::isfinite(val)) {
+        size_t const start = m_buffer.size();
+        detail::append_number(m_buffer, val);
+        // keep integral floats distinguishable from integers, so that
+        // parse_json() reads them back as floats
+        std::string_view const text(m_buffer.data() + start, m_buffer.size() - start);
+        if (text.find_first_of(".e") == std::string_view::npos) {
+          m_buffer.append(std::string_view(".0"));
+        }
+      } else {
+        // JSON has no representation for inf and nan
+        m_buffer.append(std::string_view("null"));
+      }
+      break;
+    }
+
+    case OT_STRING: {
+      SQChar const* val;
+      SQInteger size;
+      sq_getstringandsize(vm, idx, &val, &size);
+      write_string(std::string_view(val, static_cast<size_t>(size)));
+      break;
+    }
+
+    case OT_TABLE:
+      write_table(vm, idx, indent);
+      break;
+
+    case OT_ARRAY:
+      write_array(vm, idx, indent);
+      break;
+
+    default:
+      throw std::runtime_error(fmt::format("JsonWriter: {} can't be written as JSON",
+                                           to_repr(vm, idx)));
+  }
+
+  maybe_flush();
+}
+
+void
+JsonWriter::write_table(HSQUIRRELVM vm, SQInteger idx, int indent)
+{
+  enter(vm, idx);
+
+  bool first = true;
+  m_buffer.push_back('{');
+  for_each_entry(vm, idx, [&] {
+    if (!first) {
+      m_buffer.push_back(',');
+    }
+    first = false;
+
+    write_newline(indent + 1);
+    write_key(vm, -2);
+    m_buffer.append(m_pretty ? std::string_view(": ") : std::string_view(":"));
+    write_value(vm, sq_gettop(vm), indent + 1);
+  });
+  if (!first) {
+    write_newline(indent);
+  }
+  m_buffer.push_back('}');
+
+  leave();
+}
+
+void
+JsonWriter::write_array(HSQUIRRELVM vm, SQInteger idx, int indent)
+{
+  enter(vm, idx);
+
+  bool first = true;
+  m_buffer.push_back('[');
+  for_each_entry(vm, idx, [&] {
+    if (!first) {
+      m_buffer.push_back(',');
+    }
+    first = false;
+
+    write_newline(indent + 1);
+    write_value(vm, sq_gettop(vm), indent + 1);
+  });
+  if (!first) {
+    write_newline(indent);
+  }
+  m_buffer.push_back(']');
+
+  leave();
+}
+
+void
+JsonWriter::write_key(HSQUIRRELVM vm, SQInteger idx)
+{
+  switch (sq_gettype(vm, idx))
+  {
+    case OT_STRING: {
+      SQChar const* val;
+      SQInteger size;
+      sq_getstringandsize(vm, idx, &val, &size);
+      write_string(std::string_view(val, static_cast<size_t>(size)));
+      break;
+    }
+
+    case OT_INTEGER: {
+      // JSON object keys are always strings
+      SQInteger val;
+      sq_getinteger(vm, idx, &val);
+      m_buffer.push_back('"');
+      detail::append_number(m_buffer, val);
+      m_buffer.push_back('"');
+      break;
+    }
+
+    default:
+      throw std::runtime_error(fmt::format("JsonWriter: {} can't be used as JSON object key",
+                                           to_repr(vm, idx)));
+  }
+}
+
+void
+JsonWriter::write_string(std::string_view str)
+{
+  m_buffer.push_back('"');
+  char const* run = str.data();
+  char const* const end = str.data() + str.size();
+  for (char const* p = run; p != end; ++p) {
+    if (char const* escape = json_escape_sequence(*p)) {
+      m_buffer.append(run, p);
+      if (*escape != '\0') {
+        m_buffer.append(std::string_view(escape));
+      } else {
+        fmt::format_to(std::back_inserter(m_buffer), "\\u{:04x}", static_cast<unsigned char>(*p));
+      }
+      run = p + 1;
+    }
+  }
+  m_buffer.append(run, end);
+  m_buffer.push_back('"');
+}
+
+void
+JsonWriter::write_newline(int indent)
+{
+  if (m_pretty) {
+    m_buffer.push_back('\n');
+    for (int i = 0; i < indent * 2; ++i) {
+      m_buffer.push_back(' ');
+    }
+  }
+}
+
+void
+JsonWriter::enter(HSQUIRRELVM vm, SQInteger idx)
+{
+  HSQOBJECT obj;
+  sq_getstackobj(vm, idx, &obj);
+
+  void const* const ptr = obj._unVal.pRefCounted;
+  if (std::find(m_path.begin(), m_path.end(), ptr) != m_path.end()) {
+    throw std::runtime_error("JsonWriter: cyclic reference can't be written as JSON");
+  }
+  m_path.push_back(ptr);
+}
+
+void
+JsonWriter::leave()
+{
+  m_path.pop_back();
+}
+
+std::string to_json(HSQUIRRELVM vm, SQInteger idx, bool pretty)
+{
+  std::string result;
+  JsonWriter writer([&result](std::string_view data) { result.append(data); }, pretty);
+  writer.write(vm, idx);
+  return result;
+}
+
+} // namespace squip
+
+/* EOF */
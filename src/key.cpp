@@ -0,0 +1,74 @@
+// squip - Utilities for Squirrel
+// Copyright (C) 2023 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "squip/key.hpp"
+
+#include "squip/squirrel_vm.hpp"
+
+namespace squip {
+
+namespace {
+
+Object intern_string(HSQUIRRELVM vm, std::string_view name)
+{
+  sq_pushstring(vm, name.data(), static_cast<SQInteger>(name.size()));
+  Object object(vm, -1);
+  sq_poptop(vm);
+  return object;
+}
+
+} // namespace
+
+Key::Key(HSQUIRRELVM vm, std::string_view name) :
+  m_name(name),
+  m_object(intern_string(vm, name))
+{
+}
+
+Key const*
+KeyLiteral::resolve(HSQUIRRELVM vm) const
+{
+  SquirrelVM* const sqvm = SquirrelVM::from_vm(vm);
+  if (sqvm == nullptr) {
+    return nullptr;
+  }
+
+  std::string_view const names[] = { name };
+  return &sqvm->get_interned_keys(slot(), names)[0];
+}
+
+void
+KeyLiteral::push(HSQUIRRELVM vm) const
+{
+  if (Key const* const key = resolve(vm)) {
+    key->push(vm);
+  } else {
+    sq_pushstring(vm, name.data(), static_cast<SQInteger>(name.size()));
+  }
+}
+
+namespace detail {
+
+size_t allocate_key_literal_slot()
+{
+  return SquirrelVM::allocate_key_slot();
+}
+
+} // namespace detail
+
+} // namespace squip
+
+/* EOF */
@@ -0,0 +1,152 @@
+// squip - Utilities for Squirrel
+// Copyright (C) 2023 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "squip/mapped_file.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fmt/format.h>
+
+namespace squip {
+
+MappedFile::MappedFile(std::filesystem::path const& path) :
+  m_data(nullptr),
+  m_size(0),
+  m_mapped(false),
+  m_buffer()
+{
+  int const fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throw std::runtime_error(fmt::format("failed to open file: {}: {}", path.string(), std::strerror(errno)));
+  }
+
+  struct stat st;
+  if (::fstat(fd, &st) < 0) {
+    int const err = errno;
+    ::close(fd);
+    throw std::runtime_error(fmt::format("failed to stat file: {}: {}", path.string(), std::strerror(err)));
+  }
+
+  if (!S_ISREG(st.st_mode) || st.st_size == 0) {
+    // pipes, FIFOs and /proc files report a size of zero and can't be
+    // mapped, read them into a buffer instead
+    try {
+      read_fd(fd);
+    } catch (std::exception const& err) {
+      ::close(fd);
+      throw std::runtime_error(fmt::format("failed to read file: {}: {}", path.string(), err.what()));
+    }
+  } else {
+    void* data = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      int const err = errno;
+      ::close(fd);
+      throw std::runtime_error(fmt::format("failed to mmap file: {}: {}", path.string(), std::strerror(err)));
+    }
+
+    m_data = data;
+    m_size = static_cast<size_t>(st.st_size);
+    m_mapped = true;
+  }
+
+  // the mapping stays valid after the file descriptor is closed
+  ::close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+  release();
+}
+
+MappedFile::MappedFile(MappedFile&& other) :
+  m_data(other.m_data),
+  m_size(other.m_size),
+  m_mapped(other.m_mapped),
+  m_buffer(std::move(other.m_buffer))
+{
+  other.m_data = nullptr;
+  other.m_size = 0;
+  other.m_mapped = false;
+}
+
+MappedFile&
+MappedFile::operator=(MappedFile&& other)
+{
+  if (&other == this) { return *this; }
+
+  release();
+
+  m_data = other.m_data;
+  m_size = other.m_size;
+  m_mapped = other.m_mapped;
+  m_buffer = std::move(other.m_buffer);
+
+  other.m_data = nullptr;
+  other.m_size = 0;
+  other.m_mapped = false;
+
+  return *this;
+}
+
+void
+MappedFile::read_fd(int fd)
+{
+  size_t size = 0;
+  m_buffer.resize(64 * 1024);
+  while (true) {
+    if (size == m_buffer.size()) {
+      m_buffer.resize(m_buffer.size() * 2);
+    }
+
+    ssize_t const ret = ::read(fd, m_buffer.data() + size, m_buffer.size() - size);
+    if (ret < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::runtime_error(std::strerror(errno));
+    } else if (ret == 0) {
+      break;
+    }
+    size += static_cast<size_t>(ret);
+  }
+  m_buffer.resize(size);
+
+  m_data = size != 0 ? m_buffer.data() : nullptr;
+  m_size = size;
+}
+
+void
+MappedFile::release()
+{
+  if (m_mapped) {
+    ::munmap(m_data, m_size);
+    m_mapped = false;
+  }
+  m_buffer.clear();
+  m_data = nullptr;
+  m_size = 0;
+}
+
+} // namespace squip
+
+/* EOF */
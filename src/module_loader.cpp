@@ -0,0 +1,252 @@
+// squip - Utilities for Squirrel
+// Copyright (C) 2023 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "squip/module_loader.hpp"
+
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+#include "squip/bundle.hpp"
+#include "squip/script_cache.hpp"
+#include "squip/squirrel_error.hpp"
+#include "squip/squirrel_vm.hpp"
+#include "squip/table_context.hpp"
+#include "squip/unpack.hpp"
+#include "squip/util.hpp"
+
+namespace squip {
+
+ModuleLoader::ModuleLoader(SquirrelVM& sqvm) :
+  m_sqvm(sqvm),
+  m_search_paths(),
+  m_bundles(),
+  m_modules(),
+  m_load_callback()
+{
+}
+
+ModuleLoader::~ModuleLoader()
+{
+  for (auto& [name, module] : m_modules) {
+    sq_release(m_sqvm.get_vm(), &module.exports);
+  }
+}
+
+void
+ModuleLoader::add_search_path(std::filesystem::path path)
+{
+  m_search_paths.emplace_back(std::move(path));
+}
+
+void
+ModuleLoader::add_bundle(Bundle& bundle)
+{
+  m_bundles.emplace_back(&bundle);
+}
+
+void
+ModuleLoader::store_require(TableContext& table, std::string_view name)
+{
+  table.store_function(name, ".s", [this](HSQUIRRELVM vm) -> SQInteger {
+    require(vm, unpack<std::string_view>(vm, 2));
+    return 1;
+  });
+}
+
+bool
+ModuleLoader::is_loaded(std::string_view name) const
+{
+  return m_modules.find(name) != m_modules.end();
+}
+
+void
+ModuleLoader::require(HSQUIRRELVM vm, std::string_view name)
+{
+  if (auto const it = m_modules.find(name); it != m_modules.end()) {
+    sq_pushobject(vm, it->second.exports);
+    return;
+  }
+
+  std::filesystem::path path = push_module_closure(vm, name);
+  if (!path.empty() && m_load_callback) {
+    try {
+      m_load_callback(name, path);
+    } catch (...) {
+      sq_poptop(vm);
+      throw;
+    }
+  }
+
+  // the module environment, delegating to the roottable
+  sq_newtable(vm);
+  sq_pushroottable(vm);
+  sq_setdelegate(vm, -2);
+
+  // register before running the module, so cyclic requires terminate;
+  // references are held by the root VM as vm might be a short lived thread
+  HSQOBJECT env;
+  sq_resetobject(&env);
+  sq_getstackobj(vm, -1, &env);
+  sq_addref(m_sqvm.get_vm(), &env);
+  std::string const key(name);
+  m_modules.emplace(key, Module{env, std::move(path)});
+
+  if (SQ_FAILED(sq_call(vm, 1, SQTrue /* retval */, SQTrue /* raiseerror */))) {
+    sq_poptop(vm);
+    auto const it = m_modules.find(key);
+    sq_release(m_sqvm.get_vm(), &it->second.exports);
+    m_modules.erase(it);
+    throw SquirrelError::from_vm(vm, fmt::format("failed to load module: {}", name));
+  }
+
+  // stack: closure, return value
+  if (sq_gettype(vm, -1) == OT_NULL) {
+    sq_poptop(vm);
+    sq_pushobject(vm, env);
+  } else {
+    HSQOBJECT& handle = m_modules.find(key)->second.exports;
+    sq_release(m_sqvm.get_vm(), &handle);
+    sq_getstackobj(vm, -1, &handle);
+    sq_addref(m_sqvm.get_vm(), &handle);
+  }
+  sq_remove(vm, -2);
+}
+
+void
+ModuleLoader::reload(HSQUIRRELVM vm, std::string_view name)
+{
+  auto const it = m_modules.find(name);
+  if (it == m_modules.end()) {
+    throw std::runtime_error(fmt::format("module not loaded: {}", name));
+  } else if (it->second.path.empty()) {
+    throw std::runtime_error(fmt::format("module not loaded from a file: {}", name));
+  }
+
+  SQInteger const oldtop = sq_gettop(vm);
+
+  // staging table, collecting the new definitions
+  sq_newtable(vm);
+  sq_pushroottable(vm);
+  sq_setdelegate(vm, -2);
+  SQInteger const staging_idx = sq_gettop(vm);
+
+  try {
+    compile_module_file(vm, it->second.path);
+  } catch (...) {
+    sq_settop(vm, oldtop);
+    throw;
+  }
+  sq_push(vm, staging_idx);
+
+  // stack: staging, closure, staging
+  if (SQ_FAILED(sq_call(vm, 1, SQTrue /* retval */, SQTrue /* raiseerror */))) {
+    sq_settop(vm, oldtop);
+    throw SquirrelError::from_vm(vm, fmt::format("failed to reload module: {}", name));
+  }
+
+  // stack: staging, closure, return value
+  SQInteger const source_idx = (sq_gettype(vm, -1) == OT_NULL) ? staging_idx : sq_gettop(vm);
+  HSQOBJECT& exports = it->second.exports;
+
+  HSQOBJECT source;
+  sq_resetobject(&source);
+  sq_getstackobj(vm, source_idx, &source);
+
+  if (source._type == exports._type && source._unVal.raw == exports._unVal.raw) {
+    // module returned the very same object again, nothing to swap
+  } else if (exports._type == OT_TABLE && source._type == OT_TABLE) {
+    // swap the contents in place, so existing references see the new code
+    sq_pushobject(vm, exports);
+    SQInteger const exports_idx = sq_gettop(vm);
+    sq_clear(vm, exports_idx);
+
+    sq_pushnull(vm);
+    while (SQ_SUCCEEDED(sq_next(vm, source_idx))) {
+      sq_push(vm, -2);
+      sq_push(vm, -2);
+      sq_newslot(vm, exports_idx, SQFalse);
+      sq_pop(vm, 2);
+    }
+  } else {
+    sq_addref(m_sqvm.get_vm(), &source);
+    sq_release(m_sqvm.get_vm(), &exports);
+    exports = source;
+  }
+
+  sq_settop(vm, oldtop);
+}
+
+std::map<std::string, std::filesystem::path, std::less<>>
+ModuleLoader::get_module_files() const
+{
+  std::map<std::string, std::filesystem::path, std::less<>> result;
+  for (auto const& [name, module] : m_modules) {
+    if (!module.path.empty()) {
+      result.emplace(name, module.path);
+    }
+  }
+  return result;
+}
+
+void
+ModuleLoader::set_load_callback(std::function<void (std::string_view, std::filesystem::path const&)> callback)
+{
+  m_load_callback = std::move(callback);
+}
+
+std::filesystem::path
+ModuleLoader::push_module_closure(HSQUIRRELVM vm, std::string_view name)
+{
+  std::string const filename = name.ends_with(".nut") ? std::string(name) : fmt::format("{}.nut", name);
+
+  for (Bundle* bundle : m_bundles) {
+    if (bundle->contains(filename)) {
+      // the Bundle caches the closure, so it has to live in the root VM
+      HSQUIRRELVM const rootvm = m_sqvm.get_vm();
+      bundle->push_closure(rootvm, filename);
+      if (vm != rootvm) {
+        sq_move(vm, rootvm, -1);
+        sq_poptop(rootvm);
+      }
+      return {};
+    }
+  }
+
+  for (auto const& directory : m_search_paths) {
+    std::filesystem::path const path = directory / filename;
+    if (std::filesystem::is_regular_file(path)) {
+      compile_module_file(vm, path);
+      return path;
+    }
+  }
+
+  throw std::runtime_error(fmt::format("module not found: {}", name));
+}
+
+void
+ModuleLoader::compile_module_file(HSQUIRRELVM vm, std::filesystem::path const& path)
+{
+  if (ScriptCache* cache = m_sqvm.get_script_cache()) {
+    cache->compile_file(vm, path);
+  } else {
+    compile_file(vm, path);
+  }
+}
+
+} // namespace squip
+
+/* EOF */
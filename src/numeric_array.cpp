@@ -0,0 +1,386 @@
+// squip - Utilities for Squirrel
+// Copyright (C) 2023 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "squip/numeric_array.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string_view>
+
+#include <fmt/format.h>
+
+#include "squip/class_binding.hpp"
+#include "squip/table_context.hpp"
+
+namespace squip {
+
+namespace {
+
+/* The kernels below are written as simple indexed loops over
+   contiguous storage so that the compiler can vectorize them.
+   Integer arithmetic is done in 64 bits and truncated on store to
+   avoid signed overflow. Integer reductions accumulate in uint64_t,
+   so a result that doesn't fit wraps around instead of being
+   undefined. */
+
+template<typename T>
+using wide_t = std::conditional_t<std::is_integral_v<T>, int64_t, T>;
+
+template<typename T>
+using reduce_t = std::conditional_t<std::is_integral_v<T>, uint64_t, double>;
+
+template<typename T>
+T narrow(wide_t<T> value)
+{
+  return static_cast<T>(value);
+}
+
+/** Sum of f(i) using four independent accumulators, which allows
+    vectorization of the reduction without reassociation flags */
+template<typename Accum, typename F>
+Accum reduce(size_t size, F f)
+{
+  Accum acc[4] = {};
+  size_t i = 0;
+  for (; i + 4 <= size; i += 4) {
+    acc[0] += f(i + 0);
+    acc[1] += f(i + 1);
+    acc[2] += f(i + 2);
+    acc[3] += f(i + 3);
+  }
+  for (; i < size; ++i) {
+    acc[0] += f(i);
+  }
+  return (acc[0] + acc[1]) + (acc[2] + acc[3]);
+}
+
+template<typename T>
+std::string_view class_name();
+
+template<>
+std::string_view class_name<float>() { return "Float32Array"; }
+
+template<>
+std::string_view class_name<double>() { return "Float64Array"; }
+
+template<>
+std::string_view class_name<int32_t>() { return "Int32Array"; }
+
+template<typename T>
+NumericArray<T>& get_array(HSQUIRRELVM vm, SQInteger idx)
+{
+  NumericArray<T>* const array = ClassBinding<NumericArray<T>>::get_instance(vm, idx);
+  if (array == nullptr) {
+    throw std::runtime_error(fmt::format("parameter {} is not a {}", idx - 1, class_name<T>()));
+  }
+  return *array;
+}
+
+bool is_number(HSQUIRRELVM vm, SQInteger idx)
+{
+  SQObjectType const type = sq_gettype(vm, idx);
+  return type == OT_INTEGER || type == OT_FLOAT;
+}
+
+template<typename T>
+T get_number(HSQUIRRELVM vm, SQInteger idx)
+{
+  if constexpr (std::is_integral_v<T>) {
+    SQInteger value;
+    sq_getinteger(vm, idx, &value);
+    return static_cast<T>(value);
+  } else {
+    SQFloat value;
+    sq_getfloat(vm, idx, &value);
+    return static_cast<T>(value);
+  }
+}
+
+/** Element-wise op(other) and op(scalar), used for add() and mul() */
+template<typename T,
+         void (NumericArray<T>::*ArrayOp)(NumericArray<T> const&),
+         void (NumericArray<T>::*ScalarOp)(T)>
+SQInteger native_elementwise(HSQUIRRELVM vm)
+{
+  try {
+    NumericArray<T>& self = get_array<T>(vm, 1);
+    if (is_number(vm, 2)) {
+      (self.*ScalarOp)(get_number<T>(vm, 2));
+    } else {
+      (self.*ArrayOp)(get_array<T>(vm, 2));
+    }
+    return 0;
+  } catch (std::exception const& err) {
+    return sq_throwerror(vm, err.what());
+  }
+}
+
+/** fma(a, b) and fma(a, scalar) */
+template<typename T>
+SQInteger native_fma(HSQUIRRELVM vm)
+{
+  try {
+    NumericArray<T>& self = get_array<T>(vm, 1);
+    NumericArray<T> const& a = get_array<T>(vm, 2);
+    if (is_number(vm, 3)) {
+      self.fma_scalar(a, get_number<T>(vm, 3));
+    } else {
+      self.fma(a, get_array<T>(vm, 3));
+    }
+    return 0;
+  } catch (std::exception const& err) {
+    return sq_throwerror(vm, err.what());
+  }
+}
+
+template<typename T>
+SQInteger native_dot(HSQUIRRELVM vm)
+{
+  try {
+    NumericArray<T> const& self = get_array<T>(vm, 1);
+    detail::push_result(vm, self.dot(get_array<T>(vm, 2)));
+    return 1;
+  } catch (std::exception const& err) {
+    return sq_throwerror(vm, err.what());
+  }
+}
+
+/** Copy the elements into a new Squirrel array */
+template<typename T>
+SQInteger native_to_array(HSQUIRRELVM vm)
+{
+  try {
+    NumericArray<T> const& self = get_array<T>(vm, 1);
+    sq_newarray(vm, self.len());
+    SQInteger i = 0;
+    for (T const value : self.get_data()) {
+      sq_pushinteger(vm, i);
+      detail::push_result(vm, value);
+      sq_set(vm, -3);
+      i += 1;
+    }
+    return 1;
+  } catch (std::exception const& err) {
+    return sq_throwerror(vm, err.what());
+  }
+}
+
+template<typename T>
+void register_numeric_array(TableContext& table)
+{
+  HSQUIRRELVM const vm = table.get_vm();
+
+  ClassBinding<NumericArray<T>> cls = new_class<NumericArray<T>>(vm);
+  cls.template constructor<SQInteger>();
+  cls.template method<&NumericArray<T>::len>("len");
+  cls.template method<&NumericArray<T>::get>("get");
+  cls.template method<&NumericArray<T>::set>("set");
+  cls.template method<&NumericArray<T>::get>("_get");
+  cls.template method<&NumericArray<T>::set>("_set");
+  cls.template method<&NumericArray<T>::fill>("fill");
+  cls.template method<&NumericArray<T>::clamp>("clamp");
+  cls.template method<&NumericArray<T>::sum>("sum");
+  cls.method("add", &native_elementwise<T, &NumericArray<T>::add, &NumericArray<T>::add_scalar>, "xx|n");
+  cls.method("mul", &native_elementwise<T, &NumericArray<T>::mul, &NumericArray<T>::mul_scalar>, "xx|n");
+  cls.method("fma", &native_fma<T>, "xxx|n");
+  cls.method("dot", &native_dot<T>, "xx");
+  cls.method("to_array", &native_to_array<T>, "x");
+
+  table.store(class_name<T>(), cls.get_handle());
+  sq_poptop(vm);
+}
+
+} // namespace
+
+template<typename T>
+NumericArray<T>::NumericArray(SQInteger size) :
+  m_data()
+{
+  if (size < 0) {
+    throw std::invalid_argument(fmt::format("invalid {} size: {}", class_name<T>(), size));
+  }
+  m_data.resize(static_cast<size_t>(size));
+}
+
+template<typename T>
+T
+NumericArray<T>::get(SQInteger idx) const
+{
+  if (idx < 0 || idx >= len()) {
+    throw std::out_of_range(fmt::format("index {} out of range", idx));
+  }
+  return m_data[static_cast<size_t>(idx)];
+}
+
+template<typename T>
+void
+NumericArray<T>::set(SQInteger idx, T value)
+{
+  if (idx < 0 || idx >= len()) {
+    throw std::out_of_range(fmt::format("index {} out of range", idx));
+  }
+  m_data[static_cast<size_t>(idx)] = value;
+}
+
+template<typename T>
+void
+NumericArray<T>::fill(T value)
+{
+  std::fill(m_data.begin(), m_data.end(), value);
+}
+
+template<typename T>
+void
+NumericArray<T>::clamp(T lo, T hi)
+{
+  if (hi < lo) {
+    throw std::invalid_argument("clamp(): lower bound greater than upper bound");
+  }
+
+  T* const dst = m_data.data();
+  size_t const size = m_data.size();
+  for (size_t i = 0; i < size; ++i) {
+    dst[i] = std::min(std::max(dst[i], lo), hi);
+  }
+}
+
+template<typename T>
+void
+NumericArray<T>::add_scalar(T value)
+{
+  T* const dst = m_data.data();
+  size_t const size = m_data.size();
+  for (size_t i = 0; i < size; ++i) {
+    dst[i] = narrow<T>(wide_t<T>(dst[i]) + value);
+  }
+}
+
+template<typename T>
+void
+NumericArray<T>::mul_scalar(T value)
+{
+  T* const dst = m_data.data();
+  size_t const size = m_data.size();
+  for (size_t i = 0; i < size; ++i) {
+    dst[i] = narrow<T>(wide_t<T>(dst[i]) * value);
+  }
+}
+
+template<typename T>
+void
+NumericArray<T>::add(NumericArray const& other)
+{
+  check_size(other);
+
+  T* const dst = m_data.data();
+  T const* const src = other.m_data.data();
+  size_t const size = m_data.size();
+  for (size_t i = 0; i < size; ++i) {
+    dst[i] = narrow<T>(wide_t<T>(dst[i]) + src[i]);
+  }
+}
+
+template<typename T>
+void
+NumericArray<T>::mul(NumericArray const& other)
+{
+  check_size(other);
+
+  T* const dst = m_data.data();
+  T const* const src = other.m_data.data();
+  size_t const size = m_data.size();
+  for (size_t i = 0; i < size; ++i) {
+    dst[i] = narrow<T>(wide_t<T>(dst[i]) * src[i]);
+  }
+}
+
+template<typename T>
+void
+NumericArray<T>::fma(NumericArray const& a, NumericArray const& b)
+{
+  check_size(a);
+  check_size(b);
+
+  T* const dst = m_data.data();
+  T const* const lhs = a.m_data.data();
+  T const* const rhs = b.m_data.data();
+  size_t const size = m_data.size();
+  for (size_t i = 0; i < size; ++i) {
+    dst[i] = narrow<T>(wide_t<T>(dst[i]) + wide_t<T>(lhs[i]) * rhs[i]);
+  }
+}
+
+template<typename T>
+void
+NumericArray<T>::fma_scalar(NumericArray const& a, T b)
+{
+  check_size(a);
+
+  T* const dst = m_data.data();
+  T const* const lhs = a.m_data.data();
+  size_t const size = m_data.size();
+  for (size_t i = 0; i < size; ++i) {
+    dst[i] = narrow<T>(wide_t<T>(dst[i]) + wide_t<T>(lhs[i]) * b);
+  }
+}
+
+template<typename T>
+typename NumericArray<T>::accum_type
+NumericArray<T>::dot(NumericArray const& other) const
+{
+  check_size(other);
+
+  T const* const lhs = m_data.data();
+  T const* const rhs = other.m_data.data();
+  return static_cast<accum_type>(reduce<reduce_t<T>>(m_data.size(), [lhs, rhs](size_t i) {
+    return static_cast<reduce_t<T>>(wide_t<T>(lhs[i]) * wide_t<T>(rhs[i]));
+  }));
+}
+
+template<typename T>
+typename NumericArray<T>::accum_type
+NumericArray<T>::sum() const
+{
+  T const* const src = m_data.data();
+  return static_cast<accum_type>(reduce<reduce_t<T>>(m_data.size(), [src](size_t i) {
+    return static_cast<reduce_t<T>>(src[i]);
+  }));
+}
+
+template<typename T>
+void
+NumericArray<T>::check_size(NumericArray const& other) const
+{
+  if (other.m_data.size() != m_data.size()) {
+    throw std::invalid_argument(fmt::format("{} size mismatch: {} != {}",
+                                            class_name<T>(), m_data.size(), other.m_data.size()));
+  }
+}
+
+template class NumericArray<float>;
+template class NumericArray<double>;
+template class NumericArray<int32_t>;
+
+void register_numeric_arrays(TableContext& table)
+{
+  register_numeric_array<float>(table);
+  register_numeric_array<double>(table);
+  register_numeric_array<int32_t>(table);
+}
+
+} // namespace squip
+
+/* EOF */
@@ -0,0 +1,127 @@
+// squip - Utilities for Squirrel
+// Copyright (C) 2023 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "squip/precompile.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <fmt/format.h>
+
+#include "squip/squirrel_error.hpp"
+#include "squip/squirrel_vm.hpp"
+#include "squip/util.hpp"
+
+namespace squip {
+
+std::vector<std::vector<std::byte>> precompile_files(std::span<std::filesystem::path const> paths,
+                                                     unsigned int num_threads)
+{
+  std::vector<std::vector<std::byte>> results(paths.size());
+
+  if (num_threads == 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  num_threads = static_cast<unsigned int>(std::min<size_t>(num_threads, paths.size()));
+
+  std::atomic<size_t> next_idx = 0;
+  std::mutex error_mutex;
+  std::exception_ptr error;
+
+  auto record_error = [&](std::exception_ptr err) {
+    std::lock_guard<std::mutex> lock(error_mutex);
+    if (!error) {
+      error = std::move(err);
+    }
+  };
+
+  auto worker = [&]{
+    try {
+      // the scratch VM is only used for compiling, the closures are
+      // serialized before the VM goes away
+      SquirrelVM sqvm;
+      HSQUIRRELVM vm = sqvm.get_vm();
+
+      // keep the error location, which is otherwise only passed to
+      // the compiler error handler
+      std::string compile_error;
+      sqvm.set_compilererrorhandler([&compile_error](SQChar const* desc, SQChar const* source, SQInteger line, SQInteger column) {
+        compile_error = fmt::format("{}:{}:{}: {}", source ? source : "<null>", line, column, desc ? desc : "<null>");
+      });
+
+      for (size_t idx = next_idx++; idx < paths.size(); idx = next_idx++) {
+        compile_error.clear();
+        try {
+          compile_file(vm, paths[idx]);
+          write_closure(vm, results[idx]);
+          sq_poptop(vm);
+        } catch (...) {
+          sq_settop(vm, 0);
+          if (compile_error.empty()) {
+            record_error(std::current_exception());
+          } else {
+            record_error(std::make_exception_ptr(
+                           SquirrelError(fmt::format("failed to compile script: {}", compile_error))));
+          }
+        }
+      }
+    } catch (...) {
+      record_error(std::current_exception());
+    }
+  };
+
+  {
+    std::vector<std::jthread> threads;
+    threads.reserve(num_threads);
+    for (unsigned int i = 0; i < num_threads; ++i) {
+      threads.emplace_back(worker);
+    }
+  }
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+
+  return results;
+}
+
+void compile_files(HSQUIRRELVM vm, std::span<std::filesystem::path const> paths,
+                   unsigned int num_threads)
+{
+  std::vector<std::vector<std::byte>> const results = precompile_files(paths, num_threads);
+
+  SQInteger const oldtop = sq_gettop(vm);
+  if (SQ_FAILED(sq_reservestack(vm, static_cast<SQInteger>(results.size())))) {
+    throw SquirrelError::from_vm(vm, "failed to reserve stack space");
+  }
+
+  try {
+    for (auto const& bytecode : results) {
+      read_closure(vm, bytecode);
+    }
+  } catch (...) {
+    sq_settop(vm, oldtop);
+    throw;
+  }
+}
+
+} // namespace squip
+
+/* EOF */
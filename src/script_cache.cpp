@@ -0,0 +1,222 @@
+// squip - Utilities for Squirrel
+// Copyright (C) 2023 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "squip/script_cache.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include <unistd.h>
+
+#include <fmt/format.h>
+
+#include "squip/mapped_file.hpp"
+#include "squip/squirrel_error.hpp"
+#include "squip/util.hpp"
+
+namespace squip {
+
+namespace {
+
+constexpr char cache_magic[4] = { 'S', 'Q', 'P', 'C' };
+constexpr uint32_t cache_format_version = 2;
+
+/** Fixed size header in front of the bytecode in each cache file,
+    checked on load to reject foreign files and entries written by an
+    incompatible build or with a different debug info setting. The
+    source hash is the same one the file name is derived from, so a
+    hash collision between two sources is not detected. */
+struct CacheHeader
+{
+  char magic[4];
+  uint32_t format_version;
+  int64_t squirrel_version;
+  uint8_t char_size;
+  uint8_t integer_size;
+  uint8_t float_size;
+  uint8_t debuginfo;
+  uint8_t padding[4];
+  uint64_t source_size;
+  uint64_t source_hash;
+};
+
+CacheHeader make_header(uint64_t source_hash, uint64_t source_size, bool debuginfo)
+{
+  CacheHeader header{};
+  std::memcpy(header.magic, cache_magic, sizeof(cache_magic));
+  header.format_version = cache_format_version;
+  header.squirrel_version = sq_getversion();
+  header.char_size = sizeof(SQChar);
+  header.integer_size = sizeof(SQInteger);
+  header.float_size = sizeof(SQFloat);
+  header.debuginfo = debuginfo ? 1 : 0;
+  header.source_size = source_size;
+  header.source_hash = source_hash;
+  return header;
+}
+
+/** Size of the bytecode of a small fixed script compiled in vm */
+size_t probe_bytecode_size(HSQUIRRELVM vm)
+{
+  squip::compile_buffer(vm, "local a = 1\nlocal b = a\n", "<probe>");
+  std::vector<std::byte> bytecode;
+  write_closure(vm, bytecode);
+  sq_poptop(vm);
+  return bytecode.size();
+}
+
+/** Debug info adds line instructions to the bytecode, as Squirrel has
+    no getter for sq_enabledebuginfo() and scripts can toggle it via
+    enabledebuginfo(), the state is detected by compiling a probe and
+    comparing its size with one compiled with debug info enabled */
+bool is_debuginfo_enabled(HSQUIRRELVM vm)
+{
+  static size_t const debuginfo_size = [] {
+    HSQUIRRELVM const probe_vm = sq_open(64);
+    sq_enabledebuginfo(probe_vm, SQTrue);
+    size_t const size = probe_bytecode_size(probe_vm);
+    sq_close(probe_vm);
+    return size;
+  }();
+
+  return probe_bytecode_size(vm) == debuginfo_size;
+}
+
+/** 64-bit FNV-1a */
+uint64_t hash_bytes(std::string_view data, uint64_t hash = 0xcbf29ce484222325ULL)
+{
+  for (unsigned char const c : data) {
+    hash ^= c;
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+/** Push the cached closure, returns false if there is no usable entry */
+bool load_entry(HSQUIRRELVM vm, std::filesystem::path const& cachefile,
+                CacheHeader const& expected)
+{
+  std::error_code ec;
+  if (!std::filesystem::exists(cachefile, ec)) {
+    return false;
+  }
+
+  try {
+    MappedFile const file(cachefile);
+    std::span<std::byte const> const data = file.get_data();
+
+    if (data.size() < sizeof(expected) ||
+        std::memcmp(data.data(), &expected, sizeof(expected)) != 0) {
+      return false;
+    }
+
+    read_closure(vm, data.subspan(sizeof(expected)));
+    return true;
+  } catch (std::exception const&) {
+    // unreadable, corrupt or truncated entry, it gets recompiled and overwritten
+    return false;
+  }
+}
+
+/** Write the closure on top of the stack to cachefile */
+void store_entry(HSQUIRRELVM vm, std::filesystem::path const& cachefile,
+                 CacheHeader const& header)
+{
+  // write to a temporary file first and rename() it into place, so
+  // that concurrent processes never see a partially written entry,
+  // the counter keeps threads of the same process apart
+  static std::atomic<uint64_t> tmpfile_counter(0);
+  std::filesystem::path tmpfile = cachefile;
+  tmpfile += fmt::format(".{}.{}.tmp", ::getpid(), tmpfile_counter.fetch_add(1));
+
+  try {
+    {
+      std::ofstream fout(tmpfile, std::ios::binary | std::ios::trunc);
+      fout.write(reinterpret_cast<char const*>(&header), sizeof(header));
+      write_closure(vm, fout);
+      fout.close();
+      if (!fout) {
+        throw std::runtime_error("failed to write cache file");
+      }
+    }
+    std::filesystem::rename(tmpfile, cachefile);
+  } catch (std::exception const&) {
+    // the cache is only an optimization, failing to fill it is not an error
+    std::error_code ec;
+    std::filesystem::remove(tmpfile, ec);
+  }
+}
+
+} // namespace
+
+ScriptCache::ScriptCache(std::filesystem::path directory) :
+  m_directory(std::move(directory)),
+  m_hits(0),
+  m_misses(0)
+{
+  std::filesystem::create_directories(m_directory);
+}
+
+ScriptCache::~ScriptCache()
+{
+}
+
+void
+ScriptCache::compile_buffer(HSQUIRRELVM vm, std::string_view buffer,
+                            const std::string& sourcename)
+{
+  // the sourcename is baked into the bytecode, so it is part of the key
+  uint64_t const source_hash = hash_bytes(buffer, hash_bytes(sourcename));
+  bool const debuginfo = is_debuginfo_enabled(vm);
+
+  // the header covers the Squirrel version and debug info state, so
+  // those are part of the key as well
+  CacheHeader const header = make_header(source_hash, buffer.size(), debuginfo);
+  uint64_t const key = hash_bytes(std::string_view(reinterpret_cast<char const*>(&header), sizeof(header)));
+  std::filesystem::path const cachefile = m_directory / fmt::format("{:016x}.cnut", key);
+
+  if (load_entry(vm, cachefile, header)) {
+    m_hits += 1;
+    return;
+  }
+
+  m_misses += 1;
+  squip::compile_buffer(vm, buffer, sourcename);
+  store_entry(vm, cachefile, header);
+}
+
+void
+ScriptCache::compile_file(HSQUIRRELVM vm, std::filesystem::path const& path)
+{
+  MappedFile const file(path);
+  compile_buffer(vm, file.get_text(), path.string());
+}
+
+void
+ScriptCache::clear()
+{
+  for (auto const& entry : std::filesystem::directory_iterator(m_directory)) {
+    if (entry.path().extension() == ".cnut") {
+      std::filesystem::remove(entry.path());
+    }
+  }
+}
+
+} // namespace squip
+
+/* EOF */
@@ -0,0 +1,152 @@
+// squip - Utilities for Squirrel
+// Copyright (C) 2023 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "squip/script_reloader.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <set>
+#include <stdexcept>
+
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <fmt/format.h>
+
+#include "squip/module_loader.hpp"
+
+namespace squip {
+
+namespace {
+
+constexpr uint32_t watch_mask = IN_CLOSE_WRITE | IN_MOVED_TO;
+
+std::filesystem::path normalize(std::filesystem::path const& path)
+{
+  std::filesystem::path const dir = path.has_parent_path() ? path.parent_path() : ".";
+  return (dir / path.filename()).lexically_normal();
+}
+
+} // namespace
+
+ScriptReloader::ScriptReloader(ModuleLoader& loader) :
+  m_loader(loader),
+  m_fd(-1),
+  m_watches()
+{
+  m_fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (m_fd < 0) {
+    throw std::runtime_error(fmt::format("failed to initialize inotify: {}", std::strerror(errno)));
+  }
+
+  try {
+    for (auto const& [name, path] : m_loader.get_module_files()) {
+      add_watch(path);
+    }
+  } catch (...) {
+    ::close(m_fd);
+    throw;
+  }
+
+  // watch modules when they get loaded, not on the next poll(), so
+  // that edits in between are not missed
+  m_loader.set_load_callback([this](std::string_view /*name*/, std::filesystem::path const& path) {
+    add_watch(path);
+  });
+}
+
+ScriptReloader::~ScriptReloader()
+{
+  m_loader.set_load_callback({});
+  ::close(m_fd);
+}
+
+std::vector<ReloadReport>
+ScriptReloader::poll(HSQUIRRELVM vm)
+{
+  std::set<std::filesystem::path> changed;
+
+  alignas(inotify_event) char buffer[4096];
+  while (true) {
+    ssize_t const len = ::read(m_fd, buffer, sizeof(buffer));
+    if (len < 0) {
+      if (errno == EINTR) {
+        continue;
+      } else if (errno == EAGAIN) {
+        break;
+      } else {
+        throw std::runtime_error(fmt::format("failed to read inotify events: {}", std::strerror(errno)));
+      }
+    }
+
+    for (char const* ptr = buffer; ptr < buffer + len; ) {
+      inotify_event const* event = reinterpret_cast<inotify_event const*>(ptr);
+      auto const it = m_watches.find(event->wd);
+      if (it != m_watches.end() && event->len > 0) {
+        changed.insert(normalize(it->second / event->name));
+      }
+      ptr += sizeof(inotify_event) + event->len;
+    }
+  }
+
+  std::vector<ReloadReport> reports;
+  if (changed.empty()) {
+    return reports;
+  }
+
+  for (auto const& [name, path] : m_loader.get_module_files()) {
+    if (!changed.contains(normalize(path))) {
+      continue;
+    }
+
+    ReloadReport report{name, path, {}, true, {}};
+    auto const start = std::chrono::steady_clock::now();
+    try {
+      m_loader.reload(vm, name);
+    } catch (std::exception const& err) {
+      report.success = false;
+      report.error = err.what();
+    }
+    report.duration = std::chrono::steady_clock::now() - start;
+
+    reports.emplace_back(std::move(report));
+  }
+
+  return reports;
+}
+
+void
+ScriptReloader::add_watch(std::filesystem::path const& path)
+{
+  std::filesystem::path const directory = normalize(path).parent_path();
+  bool const watched = std::any_of(m_watches.begin(), m_watches.end(),
+                                   [&directory](auto const& watch) { return watch.second == directory; });
+  if (watched) {
+    return;
+  }
+
+  int const wd = ::inotify_add_watch(m_fd, directory.c_str(), watch_mask);
+  if (wd < 0) {
+    throw std::runtime_error(fmt::format("failed to watch directory: {}: {}",
+                                         directory.string(), std::strerror(errno)));
+  }
+  m_watches[wd] = directory;
+}
+
+} // namespace squip
+
+/* EOF */
@@ -16,138 +16,394 @@
 
 #include "squip/serialize.hpp"
 
-#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string_view>
 
-#include "squip/squirrel_error.hpp"
-#if 0
-#include "util/reader_mapping.hpp"
-#include "util/writer.hpp"
-#endif
+#include <unistd.h>
+
+#include <fmt/format.h>
+
+#include "squip/mapped_file.hpp"
+#include "squip/util.hpp"
+
+#include "binary_codec.hpp"
 
 namespace squip {
 
-#if 0
-void load_squirrel_table(HSQUIRRELVM vm, SQInteger table_idx, const ReaderMapping& mapping)
+/*
+  Binary table format, all multi-byte values are little endian:
+
+    header:   "SQTB" u8:version
+    value:    u8:tag payload
+
+  Tags and their payload:
+
+    Null, False, True   none
+    Integer             varint:zigzag(value)
+    Float32, Float64    4 or 8 bytes IEEE 754
+    StringDef           varint:length bytes, appended to the string table
+    StringRef           varint:index into the string table
+    Table               varint:count count*(value:key value)
+    Array               varint:count count*value
+
+  The root value is always a Table. Varints are unsigned LEB128.
+*/
+
+namespace {
+
+using detail::BinaryDecoder;
+using detail::BinaryEncoder;
+using detail::Tag;
+
+constexpr std::string_view magic = "SQTB";
+constexpr uint8_t format_version = 1;
+
+/** flush threshold when writing to a stream */
+constexpr size_t chunk_size = 64 * 1024;
+
+constexpr int max_depth = 1024;
+
+bool is_closure(SQObjectType type)
+{
+  return type == OT_CLOSURE || type == OT_NATIVECLOSURE;
+}
+
+class TableWriter
 {
-  if (table_idx < 0)
-    table_idx -= 2;
+public:
+  TableWriter(HSQUIRRELVM vm, std::vector<std::byte>& out, std::ostream* stream) :
+    m_vm(vm),
+    m_out(out),
+    m_stream(stream),
+    m_encoder(out),
+    m_path()
+  {
+  }
 
-  auto const& arr = mapping.get_sexp().as_array();
-  for (size_t i = 1; i < arr.size(); ++i)
+  void write(SQInteger table_idx)
   {
-    auto const& pair = arr[i].as_array();
+    if (sq_gettype(m_vm, table_idx) != OT_TABLE) {
+      throw std::runtime_error("save_squirrel_table: value is not a table");
+    }
 
-    // Ignore key value pairs with invalid length
-    if (pair.size() < 2)
-    {
-      log_debug << "Found key/value pair with invalid length. Ignoring." << std::endl;
-      continue;
+    for (char const c : magic) {
+      m_encoder.write_u8(static_cast<uint8_t>(c));
     }
+    m_encoder.write_u8(format_version);
 
-    const std::string& key = pair[0].as_string();
-    auto const& value = pair[1];
+    write_table(absolute_index(m_vm, table_idx));
+    flush();
+  }
 
-    // ignore empty / null values
-    if (value.is_nil())
-    {
-      log_debug << "Found null value for key " << key << ". Ignoring." << std::endl;
-      continue;
+private:
+  void flush()
+  {
+    if (m_stream != nullptr && !m_out.empty()) {
+      m_stream->write(reinterpret_cast<char const*>(m_out.data()),
+                      static_cast<std::streamsize>(m_out.size()));
+      if (!*m_stream) {
+        throw std::runtime_error("save_squirrel_table: write failed");
+      }
+      m_out.clear();
     }
-    // push the key
-    sq_pushstring(vm, key.c_str(), key.size());
+  }
 
-    // push the value
-    switch (value.get_type()) {
-      case sexp::Value::Type::ARRAY:
-        sq_newtable(vm);
-        load_squirrel_table(vm, sq_gettop(vm), ReaderMapping(mapping.get_doc(), arr[i]));
-        break;
-      case sexp::Value::Type::INTEGER:
-        sq_pushinteger(vm, value.as_int());
-        break;
-      case sexp::Value::Type::REAL:
-        sq_pushfloat(vm, value.as_float());
-        break;
-      case sexp::Value::Type::STRING:
-        sq_pushstring(vm, value.as_string().c_str(), -1);
+  void maybe_flush()
+  {
+    if (m_out.size() >= chunk_size) {
+      flush();
+    }
+  }
+
+  void write_value(SQInteger idx)
+  {
+    if (m_encoder.write_primitive(m_vm, idx)) {
+      return;
+    }
+
+    switch (sq_gettype(m_vm, idx))
+    {
+      case OT_TABLE:
+        write_table(idx);
         break;
-      case sexp::Value::Type::BOOLEAN:
-        sq_pushbool(vm, value.as_bool() ? SQTrue : SQFalse);
+
+      case OT_ARRAY:
+        write_array(idx);
         break;
-      case sexp::Value::Type::SYMBOL:
-        log_fatal << "Unexpected symbol in file: " << value.as_string() << std::endl;
-        sq_pushnull(vm);
+
+      case OT_CLOSURE:
+      case OT_NATIVECLOSURE:
+        m_encoder.write_tag(Tag::Null);
         break;
+
       default:
-        assert(false);
-        break;
+        throw std::runtime_error(fmt::format("save_squirrel_table: can't serialize {}",
+                                             to_repr(m_vm, idx)));
     }
+  }
+
+  void write_table(SQInteger idx)
+  {
+    enter(idx);
+
+    uint64_t count = 0;
+    for_each_entry(m_vm, idx, [&] {
+      if (!is_closure(sq_gettype(m_vm, -1))) {
+        count += 1;
+      }
+    });
+
+    m_encoder.write_tag(Tag::Table);
+    m_encoder.write_varint(count);
+    for_each_entry(m_vm, idx, [&] {
+      if (!is_closure(sq_gettype(m_vm, -1))) {
+        SQInteger const top = sq_gettop(m_vm);
+        write_value(top - 1);
+        write_value(top);
+        maybe_flush();
+      }
+    });
+
+    m_path.pop_back();
+  }
+
+  void write_array(SQInteger idx)
+  {
+    enter(idx);
+
+    m_encoder.write_tag(Tag::Array);
+    m_encoder.write_varint(static_cast<uint64_t>(sq_getsize(m_vm, idx)));
+    for_each_entry(m_vm, idx, [&] {
+      write_value(sq_gettop(m_vm));
+      maybe_flush();
+    });
+
+    m_path.pop_back();
+  }
 
-    if (SQ_FAILED(sq_createslot(vm, table_idx))) {
-      throw SquirrelError(vm, "failed to create new index");
+  void enter(SQInteger idx)
+  {
+    HSQOBJECT obj;
+    sq_getstackobj(m_vm, idx, &obj);
+
+    void const* const ptr = obj._unVal.pRefCounted;
+    if (std::find(m_path.begin(), m_path.end(), ptr) != m_path.end()) {
+      throw std::runtime_error("save_squirrel_table: cyclic reference can't be serialized");
     }
+    if (m_path.size() >= static_cast<size_t>(max_depth)) {
+      throw std::runtime_error("save_squirrel_table: nesting too deep");
+    }
+    m_path.push_back(ptr);
   }
-}
 
-void save_squirrel_table(HSQUIRRELVM vm, SQInteger table_idx, Writer& writer)
+private:
+  HSQUIRRELVM m_vm;
+  std::vector<std::byte>& m_out;
+  std::ostream* m_stream;
+  BinaryEncoder m_encoder;
+
+  /** tables and arrays on the path from the root to the current value */
+  std::vector<void const*> m_path;
+
+public:
+  TableWriter(TableWriter const&) = delete;
+  TableWriter& operator=(TableWriter const&) = delete;
+};
+
+class TableReader
 {
-  table_idx = absolute_index(table_idx);
-
-  //iterator table
-  sq_pushnull(vm);
-  while (SQ_SUCCEEDED(sq_next(vm, table_idx))) {
-    if (sq_gettype(vm, -2) != OT_STRING) {
-      get_logging_instance(false) << "Table contains non-string key\n";
-      continue;
-    }
-    const SQChar* key;
-    sq_getstring(vm, -2, &key);
-
-    switch (sq_gettype(vm, -1)) {
-      case OT_INTEGER: {
-        SQInteger val;
-        sq_getinteger(vm, -1, &val);
-        writer.write(key, static_cast<int> (val));
-        break;
+public:
+  TableReader(HSQUIRRELVM vm, std::span<std::byte const> data) :
+    m_vm(vm),
+    m_decoder(data, "load_squirrel_table"),
+    m_pool_idx(0),
+    m_depth(0)
+  {
+  }
+
+  size_t read(SQInteger table_idx)
+  {
+    if (sq_gettype(m_vm, table_idx) != OT_TABLE) {
+      throw std::runtime_error("load_squirrel_table: value is not a table");
+    }
+    table_idx = absolute_index(m_vm, table_idx);
+
+    for (char const c : magic) {
+      if (m_decoder.read_u8() != static_cast<uint8_t>(c)) {
+        m_decoder.error("not a squip table");
       }
-      case OT_FLOAT: {
-        SQFloat val;
-        sq_getfloat(vm, -1, &val);
-        writer.write(key, static_cast<float> (val));
+    }
+    if (m_decoder.read_u8() != format_version) {
+      m_decoder.error("unsupported format version");
+    }
+    if (m_decoder.read_tag() != Tag::Table) {
+      m_decoder.error("root value is not a table");
+    }
+
+    // keeps the strings referenced by the decoder alive
+    sq_newarray(m_vm, 0);
+    m_pool_idx = sq_gettop(m_vm);
+
+    read_entries(table_idx, m_decoder.read_count());
+
+    sq_poptop(m_vm);
+    return m_decoder.get_offset();
+  }
+
+private:
+  void read_value()
+  {
+    if (SQ_FAILED(sq_reservestack(m_vm, 4))) {
+      m_decoder.error("failed to grow the stack");
+    }
+
+    Tag const tag = m_decoder.read_tag();
+    if (m_decoder.push_primitive(m_vm, tag, m_pool_idx)) {
+      return;
+    }
+
+    switch (tag)
+    {
+      case Tag::Table: {
+        SQInteger const count = m_decoder.read_count();
+        enter();
+        sq_newtableex(m_vm, count);
+        read_entries(sq_gettop(m_vm), count);
+        m_depth -= 1;
         break;
       }
-      case OT_BOOL: {
-        SQBool val;
-        if (SQ_SUCCEEDED(sq_getbool(vm, -1, &val)))
-          writer.write(key, val == SQTrue);
+
+      case Tag::Array: {
+        SQInteger const count = m_decoder.read_count();
+        enter();
+        sq_newarray(m_vm, count);
+        for (SQInteger i = 0; i < count; ++i) {
+          sq_pushinteger(m_vm, i);
+          read_value();
+          sq_set(m_vm, -3);
+        }
+        m_depth -= 1;
         break;
       }
-      case OT_STRING: {
-        const SQChar* str;
-        sq_getstring(vm, -1, &str);
-        writer.write(key, reinterpret_cast<const char*> (str));
-        break;
+
+      default:
+        m_decoder.error("invalid tag");
+    }
+  }
+
+  void read_entries(SQInteger table_idx, SQInteger count)
+  {
+    for (SQInteger i = 0; i < count; ++i) {
+      read_value();
+      if (sq_gettype(m_vm, -1) == OT_NULL) {
+        m_decoder.error("null key");
       }
-      case OT_TABLE: {
-        writer.start_list(key, true);
-        save_squirrel_table(vm, -1, writer);
-        writer.end_list(key);
-        break;
+      read_value();
+      if (SQ_FAILED(sq_newslot(m_vm, table_idx, SQFalse))) {
+        m_decoder.error("failed to store entry");
+      }
+    }
+  }
+
+  void enter()
+  {
+    if (++m_depth > max_depth) {
+      m_decoder.error("nesting too deep");
+    }
+  }
+
+private:
+  HSQUIRRELVM m_vm;
+  BinaryDecoder m_decoder;
+  SQInteger m_pool_idx;
+  int m_depth;
+
+public:
+  TableReader(TableReader const&) = delete;
+  TableReader& operator=(TableReader const&) = delete;
+};
+
+} // namespace
+
+void save_squirrel_table(HSQUIRRELVM vm, SQInteger table_idx, std::vector<std::byte>& out)
+{
+  // an error inside for_each_entry() leaves iterator, key and value
+  // behind, drop them together with the partial output
+  SQInteger const oldtop = sq_gettop(vm);
+  size_t const oldsize = out.size();
+  try {
+    TableWriter writer(vm, out, nullptr);
+    writer.write(table_idx);
+  } catch (...) {
+    out.resize(oldsize);
+    sq_settop(vm, oldtop);
+    throw;
+  }
+}
+
+void save_squirrel_table(HSQUIRRELVM vm, SQInteger table_idx, std::ostream& out)
+{
+  SQInteger const oldtop = sq_gettop(vm);
+  try {
+    std::vector<std::byte> buffer;
+    buffer.reserve(chunk_size);
+    TableWriter writer(vm, buffer, &out);
+    writer.write(table_idx);
+  } catch (...) {
+    sq_settop(vm, oldtop);
+    throw;
+  }
+}
+
+void save_squirrel_table(HSQUIRRELVM vm, SQInteger table_idx, std::filesystem::path const& path)
+{
+  // write to a temporary file first and rename() it into place, so
+  // that a failed save leaves an existing file untouched
+  static std::atomic<uint64_t> tmpfile_counter(0);
+  std::filesystem::path tmpfile = path;
+  tmpfile += fmt::format(".{}.{}.tmp", ::getpid(), tmpfile_counter.fetch_add(1));
+
+  try {
+    {
+      std::ofstream out(tmpfile, std::ios::binary | std::ios::trunc);
+      if (!out) {
+        throw std::runtime_error(fmt::format("save_squirrel_table: failed to open {}", tmpfile.string()));
+      }
+      save_squirrel_table(vm, table_idx, out);
+      out.close();
+      if (!out) {
+        throw std::runtime_error(fmt::format("save_squirrel_table: failed to write {}", tmpfile.string()));
       }
-      case OT_CLOSURE:
-        break; // ignore
-      case OT_NATIVECLOSURE:
-        break;
-      default:
-        get_logging_instance(false) << "Can't serialize key '" << key
-                                    << "' in table.\n";
-        break;
     }
-    sq_pop(vm, 2);
+    std::filesystem::rename(tmpfile, path);
+  } catch (...) {
+    std::error_code ec;
+    std::filesystem::remove(tmpfile, ec);
+    throw;
+  }
+}
+
+size_t load_squirrel_table(HSQUIRRELVM vm, SQInteger table_idx, std::span<std::byte const> data)
+{
+  SQInteger const oldtop = sq_gettop(vm);
+  try {
+    TableReader reader(vm, data);
+    return reader.read(table_idx);
+  } catch (...) {
+    sq_settop(vm, oldtop);
+    throw;
   }
-  sq_pop(vm, 1);
 }
-#endif
+
+void load_squirrel_table(HSQUIRRELVM vm, SQInteger table_idx, std::filesystem::path const& path)
+{
+  MappedFile const file(path);
+  load_squirrel_table(vm, table_idx, file.get_data());
+}
 
 } // namespace squip
 
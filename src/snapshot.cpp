@@ -0,0 +1,695 @@
+// squip - Utilities for Squirrel
+// Copyright (C) 2023 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "squip/snapshot.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <unistd.h>
+
+#include <fmt/format.h>
+
+#include "squip/mapped_file.hpp"
+#include "squip/object.hpp"
+#include "squip/stack_guard.hpp"
+#include "squip/util.hpp"
+
+#include "binary_codec.hpp"
+
+namespace squip {
+
+/*
+  Snapshot format, an extension of the table format in serialize.cpp:
+
+    header:   "SQSN" u8:version varint:count count*(value:key value)
+
+  The entries are those of the root table. Tables, arrays, closures,
+  native closures, classes and instances get ascending object ids in
+  the order they are first encountered, with the root table being 0,
+  later occurrences are written as ObjectRef.
+
+    Table               varint:count count*(value:key value)
+    Array               varint:count count*value
+    Closure             varint:length bytecode
+    Native              varint:length name
+    Class               value:base varint:count count*(u8:static value:key value)
+    Instance            value:class varint:count count*(value:key value)
+    ObjectRef           varint:id
+
+  Class members are ordered fields first, as a class can't get new
+  fields once it has instances.
+*/
+
+namespace {
+
+using detail::BinaryDecoder;
+using detail::BinaryEncoder;
+using detail::Tag;
+
+constexpr std::string_view magic = "SQSN";
+constexpr uint8_t format_version = 1;
+
+constexpr int max_depth = 1024;
+
+void const* object_ptr(HSQUIRRELVM vm, SQInteger idx)
+{
+  HSQOBJECT obj;
+  sq_getstackobj(vm, idx, &obj);
+  return obj._unVal.pRefCounted;
+}
+
+/** Check if the key at key_idx is a non-static member of the class at class_idx */
+bool is_field(HSQUIRRELVM vm, SQInteger class_idx, SQInteger key_idx)
+{
+  sq_push(vm, key_idx);
+  HSQMEMBERHANDLE handle;
+  if (SQ_FAILED(sq_getmemberhandle(vm, class_idx, &handle))) {
+    sq_poptop(vm);
+    return false;
+  }
+  return !handle._static;
+}
+
+class SnapshotWriter
+{
+public:
+  SnapshotWriter(HSQUIRRELVM vm, std::vector<std::byte>& out) :
+    m_vm(vm),
+    m_encoder(out),
+    m_objects(),
+    m_depth(0)
+  {
+  }
+
+  void write()
+  {
+    for (char const c : magic) {
+      m_encoder.write_u8(static_cast<uint8_t>(c));
+    }
+    m_encoder.write_u8(format_version);
+
+    sq_pushroottable(m_vm);
+    SQInteger const root = sq_gettop(m_vm);
+    m_objects.emplace(object_ptr(m_vm, root), 0);
+    write_entries(root);
+    sq_poptop(m_vm);
+  }
+
+private:
+  /** Check if the value at idx can be part of a snapshot */
+  bool is_snapshotable(SQInteger idx)
+  {
+    switch (sq_gettype(m_vm, idx))
+    {
+      case OT_NULL:
+      case OT_BOOL:
+      case OT_INTEGER:
+      case OT_FLOAT:
+      case OT_STRING:
+      case OT_TABLE:
+      case OT_ARRAY:
+      case OT_CLOSURE:
+      case OT_NATIVECLOSURE:
+        return true;
+
+      case OT_CLASS: {
+        if (m_objects.contains(object_ptr(m_vm, idx))) {
+          return true;
+        }
+
+        // classes with a typetag are bound from C++
+        SQUserPointer typetag = nullptr;
+        sq_gettypetag(m_vm, idx, &typetag);
+        if (typetag != nullptr) {
+          return false;
+        }
+
+        sq_getbase(m_vm, idx);
+        bool const result = sq_gettype(m_vm, -1) == OT_NULL || is_snapshotable(sq_gettop(m_vm));
+        sq_poptop(m_vm);
+        return result;
+      }
+
+      case OT_INSTANCE: {
+        sq_getclass(m_vm, idx);
+        bool const result = is_snapshotable(sq_gettop(m_vm));
+        sq_poptop(m_vm);
+        return result;
+      }
+
+      default:
+        return false;
+    }
+  }
+
+  void write_value(SQInteger idx)
+  {
+    if (!m_encoder.write_primitive(m_vm, idx)) {
+      write_object(idx);
+    }
+  }
+
+  void write_object(SQInteger idx)
+  {
+    void const* const ptr = object_ptr(m_vm, idx);
+    auto const it = m_objects.find(ptr);
+    if (it != m_objects.end()) {
+      m_encoder.write_tag(Tag::ObjectRef);
+      m_encoder.write_varint(it->second);
+      return;
+    }
+    m_objects.emplace(ptr, m_objects.size());
+
+    if (++m_depth > max_depth) {
+      throw std::runtime_error("save_snapshot: nesting too deep");
+    }
+
+    switch (sq_gettype(m_vm, idx))
+    {
+      case OT_TABLE:
+        m_encoder.write_tag(Tag::Table);
+        write_entries(idx);
+        break;
+
+      case OT_ARRAY:
+        m_encoder.write_tag(Tag::Array);
+        m_encoder.write_varint(static_cast<uint64_t>(sq_getsize(m_vm, idx)));
+        for_each_entry(m_vm, idx, [&] {
+          SQInteger const top = sq_gettop(m_vm);
+          if (is_snapshotable(top)) {
+            write_value(top);
+          } else {
+            m_encoder.write_tag(Tag::Null);
+          }
+        });
+        break;
+
+      case OT_CLOSURE: {
+        std::vector<std::byte> bytecode;
+        sq_push(m_vm, idx);
+        write_closure(m_vm, bytecode);
+        sq_poptop(m_vm);
+
+        m_encoder.write_tag(Tag::Closure);
+        m_encoder.write_bytes(bytecode.data(), bytecode.size());
+        break;
+      }
+
+      case OT_NATIVECLOSURE:
+        write_native(idx);
+        break;
+
+      case OT_CLASS:
+        write_class(idx);
+        break;
+
+      case OT_INSTANCE:
+        write_instance(idx);
+        break;
+
+      default:
+        throw std::runtime_error(fmt::format("save_snapshot: can't serialize {}", to_repr(m_vm, idx)));
+    }
+
+    m_depth -= 1;
+  }
+
+  void write_native(SQInteger idx)
+  {
+    char const* name = nullptr;
+    if (SQ_SUCCEEDED(sq_getclosurename(m_vm, idx))) {
+      sq_getstring(m_vm, -1, &name);
+      sq_poptop(m_vm);
+    }
+
+    // the name string stays alive as it is referenced by the closure
+    if (name == nullptr) {
+      throw std::runtime_error("save_snapshot: native closure without name can't be serialized");
+    }
+
+    m_encoder.write_tag(Tag::Native);
+    m_encoder.write_bytes(name, std::char_traits<char>::length(name));
+  }
+
+  /** Write the snapshotable entries of the table at idx */
+  void write_entries(SQInteger idx)
+  {
+    uint64_t count = 0;
+    for_each_entry(m_vm, idx, [&] {
+      SQInteger const top = sq_gettop(m_vm);
+      if (is_snapshotable(top - 1) && is_snapshotable(top)) {
+        count += 1;
+      }
+    });
+
+    m_encoder.write_varint(count);
+    for_each_entry(m_vm, idx, [&] {
+      SQInteger const top = sq_gettop(m_vm);
+      if (is_snapshotable(top - 1) && is_snapshotable(top)) {
+        write_value(top - 1);
+        write_value(top);
+      }
+    });
+  }
+
+  void write_class(SQInteger idx)
+  {
+    sq_getbase(m_vm, idx);
+    SQInteger const base = sq_gettop(m_vm);
+    if (sq_gettype(m_vm, base) != OT_NULL && !is_snapshotable(base)) {
+      throw std::runtime_error("save_snapshot: class derived from a native class can't be serialized");
+    }
+    m_encoder.write_tag(Tag::Class);
+    write_value(base);
+    sq_poptop(m_vm);
+
+    uint64_t count = 0;
+    for_each_entry(m_vm, idx, [&] {
+      if (is_snapshotable(sq_gettop(m_vm))) {
+        count += 1;
+      }
+    });
+    m_encoder.write_varint(count);
+
+    // fields first, they can't be added once the class has instances
+    for (bool const static_pass : {false, true}) {
+      for_each_entry(m_vm, idx, [&] {
+        SQInteger const top = sq_gettop(m_vm);
+        if (is_snapshotable(top) && is_field(m_vm, idx, top - 1) != static_pass) {
+          m_encoder.write_u8(static_pass ? 1 : 0);
+          write_value(top - 1);
+          write_value(top);
+        }
+      });
+    }
+  }
+
+  void write_instance(SQInteger idx)
+  {
+    sq_getclass(m_vm, idx);
+    SQInteger const cls = sq_gettop(m_vm);
+    m_encoder.write_tag(Tag::Instance);
+    write_value(cls);
+
+    uint64_t count = 0;
+    for_each_entry(m_vm, idx, [&] {
+      SQInteger const top = sq_gettop(m_vm);
+      if (is_snapshotable(top) && is_field(m_vm, cls, top - 1)) {
+        count += 1;
+      }
+    });
+
+    m_encoder.write_varint(count);
+    for_each_entry(m_vm, idx, [&] {
+      SQInteger const top = sq_gettop(m_vm);
+      if (is_snapshotable(top) && is_field(m_vm, cls, top - 1)) {
+        write_value(top - 1);
+        write_value(top);
+      }
+    });
+
+    sq_poptop(m_vm);
+  }
+
+private:
+  HSQUIRRELVM m_vm;
+  BinaryEncoder m_encoder;
+
+  /** object to object id */
+  std::unordered_map<void const*, uint64_t> m_objects;
+
+  int m_depth;
+
+public:
+  SnapshotWriter(SnapshotWriter const&) = delete;
+  SnapshotWriter& operator=(SnapshotWriter const&) = delete;
+};
+
+class SnapshotReader
+{
+public:
+  SnapshotReader(HSQUIRRELVM vm, std::span<std::byte const> data, NativeRegistry const& registry) :
+    m_vm(vm),
+    m_registry(registry),
+    m_decoder(data, "load_snapshot"),
+    m_pool_idx(0),
+    m_objects(),
+    m_depth(0)
+  {
+  }
+
+  void read()
+  {
+    for (char const c : magic) {
+      if (m_decoder.read_u8() != static_cast<uint8_t>(c)) {
+        m_decoder.error("not a squip snapshot");
+      }
+    }
+    if (m_decoder.read_u8() != format_version) {
+      m_decoder.error("unsupported format version");
+    }
+
+    // keeps the strings referenced by the decoder and the objects in
+    // m_objects alive
+    sq_newarray(m_vm, 0);
+    m_pool_idx = sq_gettop(m_vm);
+
+    sq_pushroottable(m_vm);
+    SQInteger const root = sq_gettop(m_vm);
+    set_object(reserve_object(), root);
+
+    read_entries(root, m_decoder.read_count());
+
+    if (!m_decoder.at_end()) {
+      m_decoder.error("unexpected trailing data");
+    }
+  }
+
+private:
+  /** Allocate the next object id, objects get their id before their
+      contents are read, so that cyclic references resolve */
+  uint64_t reserve_object()
+  {
+    HSQOBJECT obj;
+    sq_resetobject(&obj);
+    m_objects.push_back(obj);
+
+    sq_pushnull(m_vm);
+    sq_arrayappend(m_vm, m_pool_idx);
+
+    return m_objects.size() - 1;
+  }
+
+  void set_object(uint64_t id, SQInteger idx)
+  {
+    sq_getstackobj(m_vm, idx, &m_objects[id]);
+
+    sq_pushinteger(m_vm, static_cast<SQInteger>(id));
+    sq_push(m_vm, idx);
+    sq_set(m_vm, m_pool_idx);
+  }
+
+  void read_value()
+  {
+    if (SQ_FAILED(sq_reservestack(m_vm, 8))) {
+      m_decoder.error("failed to grow the stack");
+    }
+
+    Tag const tag = m_decoder.read_tag();
+    if (m_decoder.push_primitive(m_vm, tag, m_pool_idx)) {
+      return;
+    }
+
+    switch (tag)
+    {
+      case Tag::ObjectRef: {
+        uint64_t const id = m_decoder.read_varint();
+        if (id >= m_objects.size() || m_objects[id]._type == OT_NULL) {
+          m_decoder.error("invalid object reference");
+        }
+        sq_pushobject(m_vm, m_objects[id]);
+        break;
+      }
+
+      default:
+        enter();
+        read_object(tag);
+        m_depth -= 1;
+        break;
+    }
+  }
+
+  void read_object(Tag tag)
+  {
+    switch (tag)
+    {
+      case Tag::Table: {
+        uint64_t const id = reserve_object();
+        SQInteger const count = m_decoder.read_count();
+        sq_newtableex(m_vm, count);
+        set_object(id, sq_gettop(m_vm));
+        read_entries(sq_gettop(m_vm), count);
+        break;
+      }
+
+      case Tag::Array: {
+        uint64_t const id = reserve_object();
+        SQInteger const count = m_decoder.read_count();
+        sq_newarray(m_vm, count);
+        set_object(id, sq_gettop(m_vm));
+        for (SQInteger i = 0; i < count; ++i) {
+          sq_pushinteger(m_vm, i);
+          read_value();
+          sq_set(m_vm, -3);
+        }
+        break;
+      }
+
+      case Tag::Closure: {
+        uint64_t const id = reserve_object();
+        std::span<std::byte const> const bytecode = m_decoder.read_bytes();
+        if (read_closure(m_vm, bytecode) != bytecode.size()) {
+          m_decoder.error("invalid closure size");
+        }
+        set_object(id, sq_gettop(m_vm));
+        break;
+      }
+
+      case Tag::Native: {
+        uint64_t const id = reserve_object();
+        std::span<std::byte const> const name = m_decoder.read_bytes();
+        std::string_view const name_str(reinterpret_cast<char const*>(name.data()), name.size());
+        if (!m_registry.push(m_vm, name_str)) {
+          m_decoder.error(fmt::format("native '{}' missing from registry", name_str));
+        }
+        set_object(id, sq_gettop(m_vm));
+        break;
+      }
+
+      case Tag::Class: {
+        uint64_t const id = reserve_object();
+        read_value();
+        SQObjectType const base_type = sq_gettype(m_vm, -1);
+        if (base_type == OT_NULL) {
+          sq_poptop(m_vm);
+        } else if (base_type != OT_CLASS) {
+          m_decoder.error("base is not a class");
+        }
+        if (SQ_FAILED(sq_newclass(m_vm, base_type == OT_CLASS))) {
+          m_decoder.error("failed to create class");
+        }
+        SQInteger const cls = sq_gettop(m_vm);
+        set_object(id, cls);
+
+        SQInteger const count = m_decoder.read_count();
+        for (SQInteger i = 0; i < count; ++i) {
+          SQBool const is_static = m_decoder.read_u8() ? SQTrue : SQFalse;
+          read_value();
+          read_value();
+          if (SQ_FAILED(sq_newslot(m_vm, cls, is_static))) {
+            m_decoder.error("failed to store class member");
+          }
+        }
+        break;
+      }
+
+      case Tag::Instance: {
+        uint64_t const id = reserve_object();
+        read_value();
+        if (sq_gettype(m_vm, -1) != OT_CLASS) {
+          m_decoder.error("instance without class");
+        }
+        if (SQ_FAILED(sq_createinstance(m_vm, -1))) {
+          m_decoder.error("failed to create instance");
+        }
+        sq_remove(m_vm, -2);
+        SQInteger const instance = sq_gettop(m_vm);
+        set_object(id, instance);
+
+        SQInteger const count = m_decoder.read_count();
+        for (SQInteger i = 0; i < count; ++i) {
+          read_value();
+          read_value();
+          if (SQ_FAILED(sq_set(m_vm, instance))) {
+            m_decoder.error("failed to store instance field");
+          }
+        }
+        break;
+      }
+
+      default:
+        m_decoder.error("invalid tag");
+    }
+  }
+
+  void read_entries(SQInteger table_idx, SQInteger count)
+  {
+    for (SQInteger i = 0; i < count; ++i) {
+      read_value();
+      if (sq_gettype(m_vm, -1) == OT_NULL) {
+        m_decoder.error("null key");
+      }
+      read_value();
+      if (SQ_FAILED(sq_newslot(m_vm, table_idx, SQFalse))) {
+        m_decoder.error("failed to store entry");
+      }
+    }
+  }
+
+  void enter()
+  {
+    if (++m_depth > max_depth) {
+      m_decoder.error("nesting too deep");
+    }
+  }
+
+private:
+  HSQUIRRELVM m_vm;
+  NativeRegistry const& m_registry;
+  BinaryDecoder m_decoder;
+
+  SQInteger m_pool_idx;
+  std::vector<HSQOBJECT> m_objects;
+  int m_depth;
+
+public:
+  SnapshotReader(SnapshotReader const&) = delete;
+  SnapshotReader& operator=(SnapshotReader const&) = delete;
+};
+
+} // namespace
+
+NativeRegistry::NativeRegistry() :
+  m_natives()
+{
+}
+
+NativeRegistry::~NativeRegistry()
+{
+}
+
+void
+NativeRegistry::add(std::string_view name, SQChar const* typemask, SQFUNCTION func)
+{
+  m_natives.insert_or_assign(std::string(name), [closure_name = std::string(name), typemask, func](HSQUIRRELVM vm) {
+    sq_newclosure(vm, func, 0);
+    sq_setnativeclosurename(vm, -1, closure_name.c_str());
+    sq_setparamscheck(vm, SQ_MATCHTYPEMASKSTRING, typemask);
+  });
+}
+
+void
+NativeRegistry::add(std::string_view name, SQChar const* typemask, std::function<SQInteger (HSQUIRRELVM)> func)
+{
+  m_natives.insert_or_assign(std::string(name), [closure_name = std::string(name), typemask, function = std::move(func)](HSQUIRRELVM vm) {
+    push_function(vm, function);
+    sq_setnativeclosurename(vm, -1, closure_name.c_str());
+    sq_setparamscheck(vm, SQ_MATCHTYPEMASKSTRING, typemask);
+  });
+}
+
+void
+NativeRegistry::add(std::string_view name, NativeFunction const& func)
+{
+  add(name, func.typemask, func.function);
+}
+
+void
+NativeRegistry::add_table(HSQUIRRELVM vm, SQInteger idx)
+{
+  for_each_entry(vm, idx, [&] {
+    if (sq_gettype(vm, -1) != OT_NATIVECLOSURE || SQ_FAILED(sq_getclosurename(vm, -1))) {
+      return;
+    }
+
+    char const* name = nullptr;
+    sq_getstring(vm, -1, &name);
+    if (name != nullptr) {
+      m_natives.insert_or_assign(std::string(name), [closure = Object(vm, -2)](HSQUIRRELVM vm_) mutable {
+        closure.push(vm_);
+      });
+    }
+    sq_poptop(vm);
+  });
+}
+
+bool
+NativeRegistry::push(HSQUIRRELVM vm, std::string_view name) const
+{
+  auto const it = m_natives.find(name);
+  if (it == m_natives.end()) {
+    return false;
+  }
+
+  it->second(vm);
+  return true;
+}
+
+void save_snapshot(HSQUIRRELVM vm, std::vector<std::byte>& out)
+{
+  StackGuard guard(vm);
+  SnapshotWriter writer(vm, out);
+  writer.write();
+}
+
+void save_snapshot(HSQUIRRELVM vm, std::filesystem::path const& path)
+{
+  std::vector<std::byte> data;
+  save_snapshot(vm, data);
+
+  // write to a temporary file first and rename() it into place, so
+  // that a failed save leaves an existing file untouched
+  static std::atomic<uint64_t> tmpfile_counter(0);
+  std::filesystem::path tmpfile = path;
+  tmpfile += fmt::format(".{}.{}.tmp", ::getpid(), tmpfile_counter.fetch_add(1));
+
+  try {
+    {
+      std::ofstream out(tmpfile, std::ios::binary | std::ios::trunc);
+      out.write(reinterpret_cast<char const*>(data.data()), static_cast<std::streamsize>(data.size()));
+      out.close();
+      if (!out) {
+        throw std::runtime_error(fmt::format("save_snapshot: failed to write {}", tmpfile.string()));
+      }
+    }
+    std::filesystem::rename(tmpfile, path);
+  } catch (...) {
+    std::error_code ec;
+    std::filesystem::remove(tmpfile, ec);
+    throw;
+  }
+}
+
+void load_snapshot(HSQUIRRELVM vm, std::span<std::byte const> data, NativeRegistry const& registry)
+{
+  StackGuard guard(vm);
+  SnapshotReader reader(vm, data, registry);
+  reader.read();
+}
+
+void load_snapshot(HSQUIRRELVM vm, std::filesystem::path const& path, NativeRegistry const& registry)
+{
+  MappedFile const file(path);
+  load_snapshot(vm, file.get_data(), registry);
+}
+
+} // namespace squip
+
+/* EOF */
@@ -17,6 +17,7 @@
 
 #include "squip/squirrel_vm.hpp"
 
+#include <atomic>
 #include <cstdarg>
 #include <cstring>
 #include <stdexcept>
@@ -125,12 +126,20 @@ SquirrelVM::my_errorhandler(HSQUIRRELVM vm)
   return SQ_OK;
 }
 
+SQInteger
+SquirrelVM::my_releasehook(SQUserPointer /*ptr*/, SQInteger /*size*/)
+{
+  return 0;
+}
+
 SquirrelVM::SquirrelVM() :
   m_vm(),
   m_printfunc(),
   m_errorfunc(),
   m_compilererrorhandler(),
-  m_errorhandler()
+  m_errorhandler(),
+  m_script_cache(),
+  m_interned_keys()
 {
   m_vm = sq_open(64);
   if (m_vm == nullptr) {
@@ -138,6 +147,7 @@ SquirrelVM::SquirrelVM() :
   }
 
   sq_setsharedforeignptr(m_vm, this);
+  sq_setsharedreleasehook(m_vm, &SquirrelVM::my_releasehook);
 }
 
 SquirrelVM::~SquirrelVM()
@@ -159,9 +169,48 @@ SquirrelVM::~SquirrelVM()
   }
 #endif
 
+  // keys hold references into the VM and must go before it
+  m_interned_keys.clear();
+
   sq_close(m_vm);
 }
 
+std::span<Key const>
+SquirrelVM::get_interned_keys(size_t slot, std::span<std::string_view const> names)
+{
+  if (slot >= m_interned_keys.size()) {
+    m_interned_keys.resize(slot + 1);
+  }
+
+  std::vector<Key>& keys = m_interned_keys[slot];
+  if (keys.empty()) {
+    keys.reserve(names.size());
+    for (std::string_view const name : names) {
+      keys.emplace_back(m_vm, name);
+    }
+  }
+
+  return keys;
+}
+
+size_t
+SquirrelVM::allocate_key_slot()
+{
+  static std::atomic<size_t> next_slot = 0;
+  return next_slot++;
+}
+
+SquirrelVM*
+SquirrelVM::from_vm(HSQUIRRELVM vm)
+{
+  // the release hook is only installed by the constructor, so it tags
+  // the shared foreign pointer as ours without dereferencing it
+  if (sq_getsharedreleasehook(vm) != &SquirrelVM::my_releasehook) {
+    return nullptr;
+  }
+  return reinterpret_cast<SquirrelVM*>(sq_getsharedforeignptr(vm));
+}
+
 void
 SquirrelVM::set_printfunc(std::function<void (char const*)> printfunc,
                           std::function<void (char const*)> errorfunc)
@@ -186,6 +235,12 @@ SquirrelVM::set_errorhandler(std::function<void (HSQUIRRELVM)> errorhandler)
   sq_seterrorhandler(m_vm);
 }
 
+void
+SquirrelVM::set_script_cache(std::filesystem::path const& directory)
+{
+  m_script_cache = std::make_unique<ScriptCache>(directory);
+}
+
 Thread
 SquirrelVM::create_thread()
 {
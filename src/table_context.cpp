@@ -48,6 +48,28 @@ TableContext::has_key(std::string_view name)
   return true;
 }
 
+bool
+TableContext::has_key(Key const& key)
+{
+  key.push(m_vm);
+  if (SQ_FAILED(sq_get(m_vm, m_idx))) {
+    return false;
+  }
+  sq_pop(m_vm, 1);
+  return true;
+}
+
+bool
+TableContext::has_key(KeyLiteral const& key)
+{
+  key.push(m_vm);
+  if (SQ_FAILED(sq_get(m_vm, m_idx))) {
+    return false;
+  }
+  sq_pop(m_vm, 1);
+  return true;
+}
+
 void
 TableContext::store_c_function(std::string_view name, char const* typemask, SQFUNCTION func)
 {
@@ -74,6 +96,12 @@ TableContext::store_function(std::string_view name, const char* typemask, std::f
   }
 }
 
+void
+TableContext::store_function(std::string_view name, NativeFunction const& func)
+{
+  store_c_function(name, func.typemask, func.function);
+}
+
 void
 TableContext::get_entry(std::string_view name)
 {
@@ -88,6 +116,24 @@ TableContext::get_entry(std::string_view name)
   }
 }
 
+void
+TableContext::get_entry(Key const& key)
+{
+  key.push(m_vm);
+  if (SQ_FAILED(sq_get(m_vm, m_idx))) {
+    throw SquirrelError::from_vm(m_vm, fmt::format("failed to get '{}' table entry", key.get_name()));
+  }
+}
+
+void
+TableContext::get_entry(KeyLiteral const& key)
+{
+  key.push(m_vm);
+  if (SQ_FAILED(sq_get(m_vm, m_idx))) {
+    throw SquirrelError::from_vm(m_vm, fmt::format("failed to get '{}' table entry", key.name));
+  }
+}
+
 void
 TableContext::delete_entry(std::string_view name)
 {
@@ -100,18 +146,52 @@ TableContext::delete_entry(std::string_view name)
 }
 
 void
-TableContext::rename_entry(std::string_view oldname, std::string_view newname)
+TableContext::delete_entry(Key const& key)
 {
-  SQInteger const oldtop = sq_gettop(m_vm);
+  key.push(m_vm);
+  sq_deleteslot(m_vm, m_idx, SQFalse);
+}
 
-  // push key
-  sq_pushstring(m_vm, newname.data(), newname.size());
+void
+TableContext::delete_entry(KeyLiteral const& key)
+{
+  key.push(m_vm);
+  sq_deleteslot(m_vm, m_idx, SQFalse);
+}
 
-  // push value and delete old oldname
+void
+TableContext::rename_entry(std::string_view oldname, std::string_view newname)
+{
+  sq_pushstring(m_vm, newname.data(), newname.size());
   sq_pushstring(m_vm, oldname.data(), oldname.size());
+  rename_pushed_entry(oldname);
+}
+
+void
+TableContext::rename_entry(Key const& oldkey, Key const& newkey)
+{
+  newkey.push(m_vm);
+  oldkey.push(m_vm);
+  rename_pushed_entry(oldkey.get_name());
+}
+
+void
+TableContext::rename_entry(KeyLiteral const& oldkey, KeyLiteral const& newkey)
+{
+  newkey.push(m_vm);
+  oldkey.push(m_vm);
+  rename_pushed_entry(oldkey.name);
+}
+
+void
+TableContext::rename_pushed_entry(std::string_view oldname)
+{
+  SQInteger const oldtop = sq_gettop(m_vm) - 2;
+
+  // replace the old key with the value and delete the old entry
   if (SQ_FAILED(sq_deleteslot(m_vm, m_idx, SQTrue))) {
     sq_settop(m_vm, oldtop);
-    throw SquirrelError::from_vm(m_vm, "failed to find 'oldname' entry in table");
+    throw SquirrelError::from_vm(m_vm, fmt::format("failed to find '{}' entry in table", oldname));
   }
 
   // create new entry
@@ -153,8 +233,29 @@ TableContext
 TableContext::create_table(std::string_view name)
 {
   sq_newtable(m_vm);
-
   sq_pushstring(m_vm, name.data(), name.size());
+  return store_new_table(name);
+}
+
+TableContext
+TableContext::create_table(Key const& key)
+{
+  sq_newtable(m_vm);
+  key.push(m_vm);
+  return store_new_table(key.get_name());
+}
+
+TableContext
+TableContext::create_table(KeyLiteral const& key)
+{
+  sq_newtable(m_vm);
+  key.push(m_vm);
+  return store_new_table(key.name);
+}
+
+TableContext
+TableContext::store_new_table(std::string_view name)
+{
   sq_push(m_vm, -2);
 
   if (SQ_FAILED(sq_createslot(m_vm, m_idx))) {
@@ -176,6 +277,28 @@ TableContext::create_or_get_table(std::string_view name)
   return TableContext(m_vm, -1);
 }
 
+TableContext
+TableContext::create_or_get_table(Key const& key)
+{
+  key.push(m_vm);
+  if (SQ_FAILED(sq_get(m_vm, m_idx))) {
+    return create_table(key);
+  }
+
+  return TableContext(m_vm, -1);
+}
+
+TableContext
+TableContext::create_or_get_table(KeyLiteral const& key)
+{
+  key.push(m_vm);
+  if (SQ_FAILED(sq_get(m_vm, m_idx))) {
+    return create_table(key);
+  }
+
+  return TableContext(m_vm, -1);
+}
+
 } // namespace squip
 
 /* EOF */
@@ -17,8 +17,6 @@
 
 #include "squip/thread.hpp"
 
-#include <fstream>
-
 #include <squirrel.h>
 #include <fmt/format.h>
 
@@ -85,11 +83,12 @@ Thread::operator=(Thread&& other)
 void
 Thread::run_script(std::filesystem::path const& path)
 {
-  std::ifstream fin(path);
-  if (!fin) {
-    throw std::runtime_error(fmt::format("failed to open file: {}", path.string()));
+  if (ScriptCache* cache = m_sqvm->get_script_cache()) {
+    cache->compile_file(m_vm, path);
+    squip::run_closure(m_vm, path.string());
+  } else {
+    squip::compile_and_run_file(m_vm, path);
   }
-  squip::compile_and_run(m_vm, fin, path.string());
 }
 
 void
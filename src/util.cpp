@@ -21,6 +21,7 @@
 #include <cstdio>
 #include <cstring>
 #include <fstream>
+#include <iterator>
 
 #include <sqstdaux.h>
 #include <sqstdblob.h>
@@ -30,51 +31,106 @@
 #include <fmt/format.h>
 
 #include "squip/array_context.hpp"
+#include "squip/key.hpp"
+#include "squip/mapped_file.hpp"
 #include "squip/object.hpp"
 #include "squip/table_context.hpp"
 
 namespace squip {
 
-void print(HSQUIRRELVM vm, SQInteger idx, std::ostream& os)
+namespace {
+
+void append(fmt::memory_buffer& out, std::string_view text)
+{
+  out.append(text.data(), text.data() + text.size());
+}
+
+void append_indent(fmt::memory_buffer& out, int indent)
+{
+  for (int i = 0; i < indent * 2; ++i) {
+    out.push_back(' ');
+  }
+}
+
+/** Returns the escape sequence for c or nullptr if c can be written as is */
+char const* escape_sequence(char c)
+{
+  switch (c) {
+    case '\t': return "\\t";
+    case '\a': return "\\a";
+    case '\b': return "\\b";
+    case '\n': return "\\n";
+    case '\r': return "\\r";
+    case '\v': return "\\v";
+    case '\f': return "\\f";
+    case '\0': return "\\0";
+    case '\\': return "\\\\";
+    case '"': return "\\\"";
+    default: return nullptr;
+  }
+}
+
+/** Write text as quoted string, runs of characters that need no
+    escaping are appended in one go */
+void append_quoted(fmt::memory_buffer& out, std::string_view text)
+{
+  out.push_back('"');
+  char const* run = text.data();
+  char const* const end = text.data() + text.size();
+  for (char const* p = run; p != end; ++p) {
+    if (char const* escape = escape_sequence(*p)) {
+      out.append(run, p);
+      append(out, escape);
+      run = p + 1;
+    }
+  }
+  out.append(run, end);
+  out.push_back('"');
+}
+
+void write_to(std::ostream& os, fmt::memory_buffer const& buffer)
+{
+  os.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+}
+
+} // namespace
+
+void print(HSQUIRRELVM vm, SQInteger idx, fmt::memory_buffer& out)
 {
   switch (sq_gettype(vm, idx))
   {
     case OT_STRING: {
       SQChar const* val;
-      if (SQ_FAILED(sq_getstring(vm, idx, &val))) {
-        os << "<failure>";
+      SQInteger size;
+      if (SQ_FAILED(sq_getstringandsize(vm, idx, &val, &size))) {
+        append(out, "<failure>");
       } else {
-        os << val;
+        out.append(val, val + size);
       }
       break;
     }
 
     default:
-      repr(vm, idx, os);
+      repr(vm, idx, out);
       break;
   }
 }
 
-void repr(HSQUIRRELVM vm, SQInteger idx, std::ostream& os, bool pretty, int indent)
+void repr(HSQUIRRELVM vm, SQInteger idx, fmt::memory_buffer& out, bool pretty, int indent)
 {
   // convert idx to positive, as sq_pushnull() would otherwise invalidate it
-  if (idx < 0) {
-    idx = sq_gettop(vm) + idx + 1;
-  }
+  idx = absolute_index(vm, idx);
 
   switch (sq_gettype(vm, idx))
   {
     case OT_NULL:
-      os << "null";
+      append(out, "null");
       break;
 
     case OT_BOOL: {
       SQBool p;
       if (SQ_SUCCEEDED(sq_getbool(vm, idx, &p))) {
-        if (p)
-          os << "true";
-        else
-          os << "false";
+        append(out, p ? "true" : "false");
       }
       break;
     }
@@ -82,129 +138,92 @@ void repr(HSQUIRRELVM vm, SQInteger idx, std::ostream& os, bool pretty, int inde
     case OT_INTEGER: {
       SQInteger val;
       sq_getinteger(vm, idx, &val);
-      os << val;
+      detail::append_number(out, val);
       break;
     }
 
     case OT_FLOAT: {
       SQFloat val;
       sq_getfloat(vm, idx, &val);
-      os << val;
+      detail::append_number(out, val);
       break;
     }
 
     case OT_STRING: {
-      const SQChar* val;
-      sq_getstring(vm, idx, &val);
-
-      os.put('"');
-      while (*val) {
-        switch (*val) {
-          case '\t': os << "\\t"; break;
-          case '\a': os << "\\a"; break;
-          case '\b': os << "\\b"; break;
-          case '\n': os << "\\n"; break;
-          case '\r': os << "\\r"; break;
-          case '\v': os << "\\v"; break;
-          case '\f': os << "\\f"; break;
-          case '\0': os << "\\0"; break;
-          case '\\': os << "\\\\"; break;
-          case '"': os << "\\\""; break;
-          default: os << *val; break;
-        }
-        val += 1;
-      }
-      os.put('"');
+      SQChar const* val;
+      SQInteger size;
+      sq_getstringandsize(vm, idx, &val, &size);
+      append_quoted(out, std::string_view(val, static_cast<size_t>(size)));
       break;
     }
 
     case OT_TABLE: {
       bool first = true;
-      if (pretty) {
-        os << "{\n";
-      } else {
-        os << "{";
-      }
-      sq_pushnull(vm);  //null iterator
-      while (SQ_SUCCEEDED(sq_next(vm, idx)))
-      {
+      append(out, pretty ? "{\n" : "{");
+      for_each_entry(vm, idx, [&] {
         if (!first) {
-          if (pretty) {
-            os << ",\n";
-          } else {
-            os << ", ";
-          }
+          append(out, pretty ? ",\n" : ", ");
         }
         first = false;
 
         if (pretty) {
-          os << std::string((indent + 1) * 2, ' ');
+          append_indent(out, indent + 1);
         }
 
-        repr(vm, -2, os, pretty, indent + 1);
-        os << ": ";
-        repr(vm, -1, os, pretty, indent + 1);
-
-        sq_pop(vm, 2); //pops key and val before the nex iteration
-      }
-      sq_pop(vm, 1);
+        repr(vm, -2, out, pretty, indent + 1);
+        append(out, ": ");
+        repr(vm, -1, out, pretty, indent + 1);
+      });
       if (pretty) {
-        os << "\n" << std::string((indent) * 2, ' ');
-        os << "}";
-      } else {
-        os << "}";
+        out.push_back('\n');
+        append_indent(out, indent);
       }
+      out.push_back('}');
       break;
     }
 
     case OT_ARRAY: {
       bool first = true;
-      os << "[";
-      sq_pushnull(vm);  //null iterator
-      while (SQ_SUCCEEDED(sq_next(vm, idx)))
-      {
+      out.push_back('[');
+      for_each_entry(vm, idx, [&] {
         if (!first) {
-          os << ", ";
+          append(out, ", ");
         }
         first = false;
 
-        //here -1 is the value and -2 is the key
         // we ignore the key, since that is just the index in an array
-        repr(vm, -1, os, pretty, indent + 1);
-
-        sq_pop(vm, 2); //pops key and val before the nex iteration
-      }
-      sq_pop(vm, 1);
-      os << "]";
+        repr(vm, -1, out, pretty, indent + 1);
+      });
+      out.push_back(']');
       break;
     }
 
     case OT_USERDATA: {
       SQUserPointer userptr;
       SQUserPointer typetag;
-      sq_getuserdata(vm, -1, &userptr, &typetag);
-      os << fmt::format("<userdata:{:p}:{:p}>", userptr, typetag);
+      sq_getuserdata(vm, idx, &userptr, &typetag);
+      fmt::format_to(std::back_inserter(out), "<userdata:{:p}:{:p}>", userptr, typetag);
       break;
     }
 
     case OT_CLOSURE:
-      if (SQ_FAILED(sq_getclosurename(vm, -1))) {
-        os << "<closure:<anonymous>>";
+      if (SQ_FAILED(sq_getclosurename(vm, idx))) {
+        append(out, "<closure:<anonymous>>");
       } else {
         char const* name = nullptr;
         sq_getstring(vm, -1, &name);
-        os << fmt::format("<closure:{}>", name ? name : "<anonymous>");
+        fmt::format_to(std::back_inserter(out), "<closure:{}>", name ? name : "<anonymous>");
         sq_poptop(vm);
       }
       break;
 
     case OT_NATIVECLOSURE: {
-      if (SQ_FAILED(sq_getclosurename(vm, -1))) {
-        os << "<native closure:<anonymous>>";
+      if (SQ_FAILED(sq_getclosurename(vm, idx))) {
+        append(out, "<native closure:<anonymous>>");
       } else {
         char const* name = nullptr;
         sq_getstring(vm, -1, &name);
-        os << fmt::format("<native closure:{}>", name ? name : "<anonymous>");
+        fmt::format_to(std::back_inserter(out), "<native closure:{}>", name ? name : "<anonymous>");
         sq_poptop(vm);
       }
       break;
@@ -212,105 +231,112 @@ void repr(HSQUIRRELVM vm, SQInteger idx, std::ostream& os, bool pretty, int inde
 
     case OT_GENERATOR: {
       HSQOBJECT obj;
-      if (SQ_FAILED(sq_getstackobj(vm, -1, &obj))) {
-        os << "<generator:<failure>>";
+      if (SQ_FAILED(sq_getstackobj(vm, idx, &obj))) {
+        append(out, "<generator:<failure>>");
       } else {
-        os << fmt::format("<generator:{:p}>", reinterpret_cast<void*>(obj._unVal.pGenerator));
+        fmt::format_to(std::back_inserter(out), "<generator:{:p}>", reinterpret_cast<void*>(obj._unVal.pGenerator));
       }
       break;
     }
 
     case OT_USERPOINTER: {
       SQUserPointer userptr;
-      sq_getuserpointer(vm, -1, &userptr);
-      os << fmt::format("<userpointer:{:p}>", userptr);
+      sq_getuserpointer(vm, idx, &userptr);
+      fmt::format_to(std::back_inserter(out), "<userpointer:{:p}>", userptr);
       break;
     }
 
     case OT_THREAD: {
       HSQOBJECT obj;
-      if (SQ_FAILED(sq_getstackobj(vm, -1, &obj))) {
-        os << "<thread:<failure>>";
+      if (SQ_FAILED(sq_getstackobj(vm, idx, &obj))) {
+        append(out, "<thread:<failure>>");
       } else {
-        os << fmt::format("<thread:{:p}>", reinterpret_cast<void*>(obj._unVal.pThread));
+        fmt::format_to(std::back_inserter(out), "<thread:{:p}>", reinterpret_cast<void*>(obj._unVal.pThread));
       }
       break;
     }
 
     case OT_CLASS: {
       HSQOBJECT obj;
-      if (SQ_FAILED(sq_getstackobj(vm, -1, &obj))) {
-        os << "<class:<failure>>";
+      if (SQ_FAILED(sq_getstackobj(vm, idx, &obj))) {
+        append(out, "<class:<failure>>");
       } else {
         SQUserPointer typetag = nullptr;
-        if (SQ_FAILED(sq_gettypetag(vm, -1, &typetag))) {
-          os << "<class:<unknown>>";
+        if (SQ_FAILED(sq_gettypetag(vm, idx, &typetag))) {
+          append(out, "<class:<unknown>>");
         } else {
-          os << fmt::format("<class:{:p}:{:p}>", reinterpret_cast<void*>(obj._unVal.pClass), typetag);
+          fmt::format_to(std::back_inserter(out), "<class:{:p}:{:p}>", reinterpret_cast<void*>(obj._unVal.pClass), typetag);
         }
       }
       break;
     }
 
     case OT_INSTANCE: {
-      std::string classstr;
-      if (SQ_FAILED(sq_getclass(vm, -1))) {
-        classstr = "<classunknown>";
-      } else {
-        std::ostringstream classos;
-        repr(vm, -1, classos);
-        sq_poptop(vm);
-
-        classstr = classos.str();
-      }
-
       HSQOBJECT obj;
-      if (SQ_FAILED(sq_getstackobj(vm, -1, &obj))) {
-        os << "<instance:<failure>>";
+      SQUserPointer typetag = nullptr;
+      if (SQ_FAILED(sq_getstackobj(vm, idx, &obj))) {
+        append(out, "<instance:<failure>>");
+      } else if (SQ_FAILED(sq_gettypetag(vm, idx, &typetag))) {
+        append(out, "<instance:<unknown>>");
       } else {
-        SQUserPointer typetag = nullptr;
-        if (SQ_FAILED(sq_gettypetag(vm, -1, &typetag))) {
-          os << "<instance:<unknown>>";
+        append(out, "<instance:");
+        if (SQ_FAILED(sq_getclass(vm, idx))) {
+          append(out, "<classunknown>");
         } else {
-          os << fmt::format("<instance:{:s}:{:p}:{:p}>",
-                            classstr,
-                            reinterpret_cast<void*>(obj._unVal.pInstance),
-                            typetag);
+          repr(vm, -1, out);
+          sq_poptop(vm);
         }
+        fmt::format_to(std::back_inserter(out), ":{:p}:{:p}>",
+                       reinterpret_cast<void*>(obj._unVal.pInstance),
+                       typetag);
       }
       break;
     }
 
     case OT_WEAKREF: {
-      os << "<weakref:";
-      if (SQ_FAILED(sq_getweakrefval(vm, -1))) {
-        os << "<failure>";
+      append(out, "<weakref:");
+      if (SQ_FAILED(sq_getweakrefval(vm, idx))) {
+        append(out, "<failure>");
       } else {
-        repr(vm, -1, os);
+        repr(vm, -1, out);
         sq_poptop(vm);
       }
-      os << ">";
+      out.push_back('>');
       break;
     }
 
     default:
-      os << "<unknown>";
+      append(out, "<unknown>");
       break;
   }
 }
 
+void print(HSQUIRRELVM vm, SQInteger idx, std::ostream& os)
+{
+  fmt::memory_buffer buffer;
+  print(vm, idx, buffer);
+  write_to(os, buffer);
+}
+
+void repr(HSQUIRRELVM vm, SQInteger idx, std::ostream& os, bool pretty, int indent)
+{
+  fmt::memory_buffer buffer;
+  repr(vm, idx, buffer, pretty, indent);
+  write_to(os, buffer);
+}
+
 std::string to_string(HSQUIRRELVM vm, SQInteger idx)
 {
-  std::ostringstream os;
-  print(vm, idx, os);
-  return os.str();
+  fmt::memory_buffer buffer;
+  print(vm, idx, buffer);
+  return fmt::to_string(buffer);
 }
 
 std::string to_repr(HSQUIRRELVM vm, SQInteger idx)
 {
-  std::ostringstream os;
-  repr(vm, idx, os);
-  return os.str();
+  fmt::memory_buffer buffer;
+  repr(vm, idx, buffer);
+  return fmt::to_string(buffer);
 }
 
 void print_stack(HSQUIRRELVM vm, std::ostream& os)
@@ -376,37 +402,61 @@ SQInteger squirrel_read_char(SQUserPointer file)
 
 void write_closure(HSQUIRRELVM vm, std::ostream& out)
 {
-  sq_writeclosure(vm, [](SQUserPointer userptr, SQUserPointer data, SQInteger len) -> SQInteger {
-    std::ofstream& out = *static_cast<std::ofstream*>(userptr);
-    if (!out.write(static_cast<char const*>(data), len)) {
+  if (SQ_FAILED(sq_writeclosure(vm, [](SQUserPointer userptr, SQUserPointer data, SQInteger len) -> SQInteger {
+    std::ostream& stream = *static_cast<std::ostream*>(userptr);
+    if (!stream.write(static_cast<char const*>(data), len)) {
       return -1;
     }
     return len;
-  }, &out);
+  }, &out))) {
+    throw SquirrelError::from_vm(vm, "failed to write closure");
+  }
+}
+
+void write_closure(HSQUIRRELVM vm, std::vector<std::byte>& out)
+{
+  if (SQ_FAILED(sq_writeclosure(vm, [](SQUserPointer userptr, SQUserPointer data, SQInteger len) -> SQInteger {
+    std::vector<std::byte>& buffer = *static_cast<std::vector<std::byte>*>(userptr);
+    std::byte const* const bytes = static_cast<std::byte const*>(data);
+    buffer.insert(buffer.end(), bytes, bytes + len);
+    return len;
+  }, &out))) {
+    throw SquirrelError::from_vm(vm, "failed to write closure");
+  }
 }
 
 void read_closure(HSQUIRRELVM vm, std::istream& in)
 {
-  sq_readclosure(vm, [](SQUserPointer userptr, SQUserPointer data, SQInteger len) -> SQInteger {
-    std::ifstream& in = *static_cast<std::ifstream*>(userptr);
-    if (!in.read(static_cast<char*>(data), len)) {
+  if (SQ_FAILED(sq_readclosure(vm, [](SQUserPointer userptr, SQUserPointer data, SQInteger len) -> SQInteger {
+    std::istream& stream = *static_cast<std::istream*>(userptr);
+    if (!stream.read(static_cast<char*>(data), len)) {
       return -1;
     }
     return len;
-  }, &in);
+  }, &in))) {
+    throw SquirrelError::from_vm(vm, "failed to read closure");
+  }
 }
 
-void compile_script(HSQUIRRELVM vm, std::istream& in, const std::string& sourcename)
+size_t read_closure(HSQUIRRELVM vm, std::span<std::byte const> data)
 {
-  if (SQ_FAILED(sq_compile(vm, squirrel_read_char, &in, sourcename.c_str(), SQTrue))) {
-    throw SquirrelError::from_vm(vm, fmt::format("failed to compile script: {}", sourcename));
+  std::span<std::byte const> rest = data;
+  if (SQ_FAILED(sq_readclosure(vm, [](SQUserPointer userptr, SQUserPointer buf, SQInteger len) -> SQInteger {
+    std::span<std::byte const>& remaining = *static_cast<std::span<std::byte const>*>(userptr);
+    if (static_cast<size_t>(len) > remaining.size()) {
+      return -1;
+    }
+    std::memcpy(buf, remaining.data(), static_cast<size_t>(len));
+    remaining = remaining.subspan(static_cast<size_t>(len));
+    return len;
+  }, &rest))) {
+    throw SquirrelError::from_vm(vm, "failed to read closure");
   }
+  return data.size() - rest.size();
 }
 
-void compile_and_run(HSQUIRRELVM vm, std::istream& in,
-                     const std::string& sourcename)
+void run_closure(HSQUIRRELVM vm, const std::string& sourcename)
 {
-  compile_script(vm, in, sourcename);
   sq_pushroottable(vm);
   if (SQ_FAILED(sq_call(vm, 1, SQFalse /* retval */, SQTrue /* raiseerror */))) {
     sq_pop(vm, 1);
@@ -419,6 +469,58 @@ void compile_and_run(HSQUIRRELVM vm, std::istream& in,
   }
 }
 
+namespace {
+
+/** Slurp the whole stream, reading it through squirrel_read_char()
+    would cost a virtual call for every single byte */
+std::string read_stream(std::istream& in)
+{
+  std::ostringstream os;
+  os << in.rdbuf();
+  return std::move(os).str();
+}
+
+} // namespace
+
+void compile_script(HSQUIRRELVM vm, std::istream& in, const std::string& sourcename)
+{
+  compile_buffer(vm, read_stream(in), sourcename);
+}
+
+void compile_buffer(HSQUIRRELVM vm, std::string_view buffer, const std::string& sourcename)
+{
+  if (SQ_FAILED(sq_compilebuffer(vm, buffer.data(), static_cast<SQInteger>(buffer.size()),
+                                 sourcename.c_str(), SQTrue))) {
+    throw SquirrelError::from_vm(vm, fmt::format("failed to compile script: {}", sourcename));
+  }
+}
+
+void compile_file(HSQUIRRELVM vm, std::filesystem::path const& path)
+{
+  MappedFile const file(path);
+  compile_buffer(vm, file.get_text(), path.string());
+}
+
+void compile_and_run(HSQUIRRELVM vm, std::istream& in,
+                     const std::string& sourcename)
+{
+  compile_script(vm, in, sourcename);
+  run_closure(vm, sourcename);
+}
+
+void compile_and_run(HSQUIRRELVM vm, std::string_view buffer,
+                     const std::string& sourcename)
+{
+  compile_buffer(vm, buffer, sourcename);
+  run_closure(vm, sourcename);
+}
+
+void compile_and_run_file(HSQUIRRELVM vm, std::filesystem::path const& path)
+{
+  compile_file(vm, path);
+  run_closure(vm, path.string());
+}
+
 HSQUIRRELVM object_to_vm(HSQOBJECT object)
 {
   if (object._type != OT_THREAD)
@@ -430,28 +532,7 @@ HSQUIRRELVM object_to_vm(HSQOBJECT object)
 void
 push_function(HSQUIRRELVM vm, std::function<SQInteger (HSQUIRRELVM)> func)
 {
-  // store the data of std::function<> in a free variable as userdata
-  SQUserPointer userptr = sq_newuserdata(vm, sizeof(func));
-  new(userptr) std::function<SQInteger (HSQUIRRELVM)>(std::move(func));
-  sq_setreleasehook(vm, -1, [](SQUserPointer uptr, SQInteger size) -> SQInteger {
-    auto* funcptr = reinterpret_cast<std::function<SQInteger (HSQUIRRELVM)>*>(uptr);
-    funcptr->~function<SQInteger (HSQUIRRELVM)>();
-    return 1;
-  });
-
-  sq_newclosure(vm, [](HSQUIRRELVM vm) -> SQInteger {
-    SQUserPointer uptr;
-    if (SQ_FAILED(sq_getuserdata(vm, -1, &uptr, nullptr))) {
-      sq_throwerror(vm, "invalid argument, must be userdata");
-      return SQ_ERROR;
-    }
-    auto* funcptr = reinterpret_cast<std::function<SQInteger (HSQUIRRELVM)>*>(uptr);
-    try {
-      return (*funcptr)(vm);
-    } catch (std::exception const& err) {
-      return sq_throwerror(vm, err.what());
-    }
-  }, 1 /* nfreevars */);
+  push_closure(vm, std::move(func));
 }
 
 SQInteger absolute_index(HSQUIRRELVM vm, SQInteger idx)
@@ -522,6 +603,25 @@ void push_value(HSQUIRRELVM vm, Null const& null)
   sq_pushnull(vm);
 }
 
+void push_value(HSQUIRRELVM vm, Key const& key)
+{
+  key.push(vm);
+}
+
+void push_value(HSQUIRRELVM vm, KeyLiteral const& key)
+{
+  key.push(vm);
+}
+
+void push_value(HSQUIRRELVM vm, NativeFunction const& func)
+{
+  sq_newclosure(vm, func.function, 0);
+  if (SQ_FAILED(sq_setparamscheck(vm, SQ_MATCHTYPEMASKSTRING, func.typemask))) {
+    sq_poptop(vm);
+    throw SquirrelError::from_vm(vm, "invalid typemask");
+  }
+}
+
 TableContext new_table(HSQUIRRELVM vm)
 {
   sq_newtable(vm);
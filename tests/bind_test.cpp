@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <string>
+
+#include <squip/bind.hpp>
+#include <squip/squirrel_error.hpp>
+#include <squip/squirrel_vm.hpp>
+#include <squip/table_context.hpp>
+#include <squip/util.hpp>
+
+namespace {
+
+int add(int lhs, int rhs)
+{
+  return lhs + rhs;
+}
+
+std::string greet(std::string const& name, bool shout)
+{
+  return (shout ? "HELLO " : "Hello ") + name;
+}
+
+double scale(double value, float factor)
+{
+  return value * factor;
+}
+
+SQInteger stack_size(HSQUIRRELVM vm, int /*unused*/)
+{
+  return sq_gettop(vm);
+}
+
+void fail(std::string const& message)
+{
+  throw std::runtime_error(message);
+}
+
+} // namespace
+
+TEST(SquipBind, typemask)
+{
+  EXPECT_STREQ(squip::bind<&add>().typemask, ".nn");
+  EXPECT_STREQ(squip::bind<&greet>().typemask, ".sb");
+  EXPECT_STREQ(squip::bind<&scale>().typemask, ".nn");
+  EXPECT_STREQ(squip::bind<&stack_size>().typemask, ".n");
+  EXPECT_STREQ(squip::bind([]{}).typemask, ".");
+}
+
+TEST(SquipBind, bind_function)
+{
+  squip::SquirrelVM sqvm;
+  HSQUIRRELVM vm = sqvm.get_vm();
+
+  {
+    squip::TableContext root = sqvm.stack().push_roottable();
+    root.store_function("add", squip::bind<&add>());
+    root.store_function("greet", squip::bind<&greet>());
+    root.store_function("scale", squip::bind<&scale>());
+    root.store_function("stack_size", squip::bind<&stack_size>());
+    sq_poptop(vm);
+  }
+
+  squip::compile_and_run(vm,
+                         "g_add <- add(3, 4);"
+                         "g_greet <- greet(\"World\", true);"
+                         "g_scale <- scale(1.5, 2);"
+                         "g_stack_size <- stack_size(5);",
+                         "<source>");
+
+  squip::TableContext root = sqvm.stack().push_roottable();
+  EXPECT_EQ(root.get<int>("g_add"), 7);
+  EXPECT_EQ(root.get<std::string>("g_greet"), "HELLO World");
+  EXPECT_FLOAT_EQ(root.get<float>("g_scale"), 3.0f);
+  EXPECT_EQ(root.get<int>("g_stack_size"), 2);
+  sq_poptop(vm);
+}
+
+TEST(SquipBind, bind_lambda)
+{
+  squip::SquirrelVM sqvm;
+  HSQUIRRELVM vm = sqvm.get_vm();
+
+  {
+    squip::TableContext root = sqvm.stack().push_roottable();
+    root.store_function("mul", squip::bind([](int lhs, int rhs) { return lhs * rhs; }));
+    root.store("negate", squip::bind([](float value) { return -value; }));
+    sq_poptop(vm);
+  }
+
+  squip::compile_and_run(vm, "g_mul <- mul(6, 7); g_negate <- negate(2.5);", "<source>");
+
+  squip::TableContext root = sqvm.stack().push_roottable();
+  EXPECT_EQ(root.get<int>("g_mul"), 42);
+  EXPECT_FLOAT_EQ(root.get<float>("g_negate"), -2.5f);
+  sq_poptop(vm);
+}
+
+TEST(SquipBind, bind_errors)
+{
+  squip::SquirrelVM sqvm;
+  HSQUIRRELVM vm = sqvm.get_vm();
+
+  {
+    squip::TableContext root = sqvm.stack().push_roottable();
+    root.store_function("add", squip::bind<&add>());
+    root.store_function("fail", squip::bind<&fail>());
+    sq_poptop(vm);
+  }
+
+  // wrong argument count and type are caught by the typemask
+  EXPECT_THROW(squip::compile_and_run(vm, "add(1);", "<source>"), squip::SquirrelError);
+  EXPECT_THROW(squip::compile_and_run(vm, "add(1, \"two\");", "<source>"), squip::SquirrelError);
+
+  // C++ exceptions are converted into Squirrel errors
+  squip::compile_and_run(vm,
+                         "try { fail(\"boom\"); } catch(err) { g_error <- err; }",
+                         "<source>");
+  squip::TableContext root = sqvm.stack().push_roottable();
+  EXPECT_EQ(root.get<std::string>("g_error"), "boom");
+  sq_poptop(vm);
+}
+
+/* EOF */
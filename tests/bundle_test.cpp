@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <sstream>
+
+#include <squip/bundle.hpp>
+#include <squip/squirrel_vm.hpp>
+#include <squip/util.hpp>
+
+TEST(SquipBundle, write_and_load)
+{
+  std::filesystem::path const path = std::filesystem::temp_directory_path() / "squip_bundle_test.sqb";
+
+  {
+    squip::SquirrelVM sqvm;
+    HSQUIRRELVM vm = sqvm.get_vm();
+
+    squip::BundleWriter writer;
+    squip::compile_buffer(vm, "print(\"two\")", "two.nut");
+    writer.add_closure(vm, "two.nut");
+    sq_poptop(vm);
+    squip::compile_buffer(vm, "print(\"one\")", "one.nut");
+    writer.add_closure(vm, "one.nut");
+    sq_poptop(vm);
+    squip::compile_file(vm, "tests/thread1.nut");
+    writer.add_closure(vm, "tests/thread1.nut");
+    sq_poptop(vm);
+    ASSERT_EQ(sq_gettop(vm), 0);
+    EXPECT_EQ(writer.size(), 3u);
+
+    writer.write(path);
+  }
+
+  squip::SquirrelVM sqvm;
+  HSQUIRRELVM vm = sqvm.get_vm();
+
+  std::ostringstream out;
+  sqvm.set_printfunc([&out](char const* msg){ out << msg; },
+                     [&out](char const* msg){ out << msg; });
+
+  {
+    squip::Bundle bundle(path);
+    EXPECT_EQ(bundle.size(), 3u);
+    EXPECT_EQ(bundle.get_names(),
+              (std::vector<std::string_view>{"one.nut", "tests/thread1.nut", "two.nut"}));
+    EXPECT_TRUE(bundle.contains("one.nut"));
+    EXPECT_TRUE(bundle.contains("two.nut"));
+    EXPECT_FALSE(bundle.contains("three.nut"));
+
+    bundle.push_closure(vm, "one.nut");
+    squip::run_closure(vm, "one.nut");
+    bundle.push_closure(vm, "two.nut");
+    squip::run_closure(vm, "two.nut");
+    bundle.push_closure(vm, "one.nut");
+    squip::run_closure(vm, "one.nut");
+    EXPECT_EQ(out.str(), "onetwoone");
+
+    EXPECT_THROW(bundle.push_closure(vm, "three.nut"), std::runtime_error);
+    ASSERT_EQ(sq_gettop(vm), 0);
+  }
+
+  EXPECT_THROW(squip::Bundle("tests/thread1.nut"), std::runtime_error);
+
+  std::filesystem::remove(path);
+}
+
+/* EOF */
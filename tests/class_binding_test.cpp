@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <utility>
+
+#include <squip/class_binding.hpp>
+#include <squip/squirrel_error.hpp>
+#include <squip/squirrel_vm.hpp>
+#include <squip/table_context.hpp>
+#include <squip/util.hpp>
+
+namespace {
+
+int g_destroyed = 0;
+
+class Counter
+{
+public:
+  Counter(std::string name, int start) :
+    m_name(std::move(name)),
+    m_count(start)
+  {}
+
+  ~Counter() { g_destroyed += 1; }
+
+  Counter(Counter const&) = delete;
+  Counter& operator=(Counter const&) = delete;
+
+  int increment(int amount) { m_count += amount; return m_count; }
+  std::string const& get_name() const { return m_name; }
+  SQInteger get_top(HSQUIRRELVM vm) const { return sq_gettop(vm); }
+
+private:
+  std::string m_name;
+  int m_count;
+};
+
+} // namespace
+
+TEST(SquipClassBinding, class_binding)
+{
+  g_destroyed = 0;
+  {
+    squip::SquirrelVM sqvm;
+    HSQUIRRELVM vm = sqvm.get_vm();
+
+    {
+      squip::TableContext root = sqvm.stack().push_roottable();
+      squip::ClassBinding<Counter> cls = squip::new_class<Counter>(vm);
+      cls.constructor<std::string, int>();
+      cls.method<&Counter::increment>("increment");
+      cls.method<&Counter::get_name>("get_name");
+      cls.method<&Counter::get_top>("get_top");
+      cls.store("label", "counter");
+      root.store("Counter", cls.get_handle());
+      sq_pop(vm, 2);
+    }
+
+    squip::compile_and_run(vm,
+                           "local c = Counter(\"apples\", 10);"
+                           "c.increment(5);"
+                           "g_count <- c.increment(1);"
+                           "g_name <- c.get_name();"
+                           "g_label <- c.label;"
+                           "g_top <- c.get_top();"
+                           "class Derived extends Counter { constructor() { base.constructor(\"derived\", 0); } };"
+                           "g_derived <- Derived().get_name();"
+                           "g_keep <- Counter(\"kept\", 1);",
+                           "<source>");
+
+    {
+      squip::TableContext root = sqvm.stack().push_roottable();
+      EXPECT_EQ(root.get<int>("g_count"), 16);
+      EXPECT_EQ(root.get<std::string>("g_name"), "apples");
+      EXPECT_EQ(root.get<std::string>("g_label"), "counter");
+      EXPECT_EQ(root.get<int>("g_top"), 1);
+      EXPECT_EQ(root.get<std::string>("g_derived"), "derived");
+
+      root.get_entry("g_keep");
+      Counter* const kept = squip::ClassBinding<Counter>::get_instance(vm, -1);
+      ASSERT_NE(kept, nullptr);
+      EXPECT_EQ(kept->get_name(), "kept");
+      sq_pop(vm, 2);
+    }
+
+    // calling a method on an instance that never got constructed
+    EXPECT_THROW(squip::compile_and_run(vm,
+                                        "class Broken extends Counter { constructor() {} };"
+                                        "Broken().get_name();",
+                                        "<source>"),
+                 squip::SquirrelError);
+    sq_settop(vm, 0);
+  }
+  EXPECT_EQ(g_destroyed, 3);
+}
+
+/* EOF */
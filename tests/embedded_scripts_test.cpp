@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <sstream>
+
+#include <squip/embedded_scripts.hpp>
+#include <squip/squirrel_vm.hpp>
+#include <squip/util.hpp>
+
+TEST(SquipEmbeddedScripts, build_time)
+{
+  // registered by squip_embed_scripts() in CMakeLists.txt
+  std::vector<std::string_view> const names = squip::get_embedded_script_names();
+  EXPECT_NE(std::find(names.begin(), names.end(), "tests/thread1.nut"), names.end());
+  EXPECT_NE(std::find(names.begin(), names.end(), "tests/thread2.nut"), names.end());
+
+  squip::SquirrelVM sqvm;
+  HSQUIRRELVM vm = sqvm.get_vm();
+
+  std::ostringstream out;
+  sqvm.set_printfunc([&out](char const* msg){ out << msg; },
+                     [&out](char const* msg){ out << msg; });
+
+  squip::compile_and_run(vm, "g_counter <- 0", "<source>");
+
+  squip::Thread thread = sqvm.create_thread();
+  squip::push_embedded_script(thread.get_vm(), "tests/thread2.nut");
+  squip::run_closure(thread.get_vm(), "tests/thread2.nut");
+  while (thread.is_suspended()) {
+    thread.wakeup();
+  }
+
+  EXPECT_TRUE(out.str().starts_with("Hello, World from thread number two!\n"));
+}
+
+TEST(SquipEmbeddedScripts, register)
+{
+  static std::vector<std::byte> bytecode;
+
+  squip::SquirrelVM sqvm;
+  HSQUIRRELVM vm = sqvm.get_vm();
+
+  squip::compile_buffer(vm, "g_value <- 42", "<embedded>");
+  squip::write_closure(vm, bytecode);
+  sq_poptop(vm);
+
+  squip::register_embedded_script("test/embedded.nut", bytecode);
+  EXPECT_TRUE(squip::find_embedded_script("test/embedded.nut").has_value());
+  EXPECT_FALSE(squip::find_embedded_script("test/missing.nut").has_value());
+
+  squip::push_embedded_script(vm, "test/embedded.nut");
+  squip::run_closure(vm, "test/embedded.nut");
+
+  squip::TableContext root = sqvm.stack().push_roottable();
+  EXPECT_EQ(root.get<int>("g_value"), 42);
+  sq_poptop(vm);
+
+  EXPECT_THROW(squip::push_embedded_script(vm, "test/missing.nut"), std::runtime_error);
+  ASSERT_EQ(sq_gettop(vm), 0);
+}
+
+/* EOF */
@@ -0,0 +1,51 @@
+#include <gtest/gtest.h>
+
+#include <squip/eval_cache.hpp>
+#include <squip/squirrel_error.hpp>
+#include <squip/squirrel_vm.hpp>
+#include <squip/table_context.hpp>
+#include <squip/util.hpp>
+
+TEST(SquipEvalCache, compile_and_run)
+{
+  squip::SquirrelVM sqvm;
+  HSQUIRRELVM vm = sqvm.get_vm();
+
+  {
+    squip::EvalCache cache(sqvm, 2);
+    squip::compile_and_run(vm, "g_counter <- 0", "<source>");
+
+    for (int i = 0; i < 10; ++i) {
+      cache.compile_and_run(vm, "g_counter += 1", "<source>");
+    }
+    EXPECT_EQ(cache.get_misses(), 1u);
+    EXPECT_EQ(cache.get_hits(), 9u);
+    EXPECT_EQ(cache.size(), 1u);
+
+    // same source with a different sourcename is recompiled
+    cache.compile_and_run(vm, "g_counter += 1", "<other>");
+    EXPECT_EQ(cache.get_misses(), 2u);
+    EXPECT_EQ(cache.size(), 1u);
+
+    // least recently used entries are evicted
+    cache.compile_and_run(vm, "g_counter += 10", "<source>");
+    cache.compile_and_run(vm, "g_counter += 1", "<other>");
+    cache.compile_and_run(vm, "g_counter += 100", "<source>");
+    EXPECT_EQ(cache.size(), 2u);
+    cache.compile_and_run(vm, "g_counter += 10", "<source>");
+    EXPECT_EQ(cache.get_misses(), 5u);
+    EXPECT_EQ(cache.get_hits(), 10u);
+
+    EXPECT_THROW(cache.compile_and_run(vm, "g_counter +", "<source>"), squip::SquirrelError);
+    ASSERT_EQ(sq_gettop(vm), 0);
+
+    squip::TableContext root = sqvm.stack().push_roottable();
+    EXPECT_EQ(root.get<int>("g_counter"), 132);
+    sq_poptop(vm);
+
+    cache.clear();
+    EXPECT_EQ(cache.size(), 0u);
+  }
+}
+
+/* EOF */
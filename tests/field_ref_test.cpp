@@ -0,0 +1,111 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include <squip/class_binding.hpp>
+#include <squip/field_ref.hpp>
+#include <squip/squirrel_error.hpp>
+#include <squip/squirrel_vm.hpp>
+#include <squip/table_context.hpp>
+#include <squip/util.hpp>
+
+namespace {
+
+struct Entity {};
+
+} // namespace
+
+TEST(SquipFieldRef, script_class)
+{
+  squip::SquirrelVM sqvm;
+  HSQUIRRELVM vm = sqvm.get_vm();
+
+  squip::compile_and_run(vm,
+                         "class Point { x = 1; y = 2.5; };"
+                         "class Point3 extends Point { z = 0; };"
+                         "g_point <- Point3();",
+                         "<source>");
+
+  squip::TableContext root = sqvm.stack().push_roottable();
+  root.get_entry("Point");
+  squip::FieldRef const x_field(vm, -1, "x");
+  squip::FieldRef const y_field(vm, -1, "y");
+  EXPECT_THROW(squip::FieldRef(vm, -1, "w"), squip::SquirrelError);
+  sq_poptop(vm);
+  ASSERT_EQ(sq_gettop(vm), 1);
+
+  root.get_entry("g_point");
+  EXPECT_EQ(x_field.get<int>(vm, -1), 1);
+  EXPECT_EQ(y_field.get<float>(vm, -1), 2.5f);
+
+  x_field.set(vm, -1, 42);
+  EXPECT_EQ(x_field.get<int>(vm, -1), 42);
+  sq_poptop(vm);
+  ASSERT_EQ(sq_gettop(vm), 1);
+
+  squip::compile_and_run(vm, "g_x <- g_point.x;", "<source>");
+  EXPECT_EQ(root.get<int>("g_x"), 42);
+  sq_poptop(vm);
+}
+
+TEST(SquipFieldRef, class_binding)
+{
+  squip::SquirrelVM sqvm;
+  HSQUIRRELVM vm = sqvm.get_vm();
+
+  squip::TableContext root = sqvm.stack().push_roottable();
+  squip::ClassBinding<Entity> cls = squip::new_class<Entity>(vm);
+  cls.store("health", 100);
+  squip::FieldRef const health = cls.field("health");
+  root.store("Entity", cls.get_handle());
+  sq_poptop(vm);
+
+  squip::compile_and_run(vm, "g_entity <- Entity();", "<source>");
+
+  root.get_entry("g_entity");
+  health.set(vm, -1, health.get<int>(vm, -1) - 25);
+  sq_poptop(vm);
+
+  squip::compile_and_run(vm, "g_health <- g_entity.health;", "<source>");
+  EXPECT_EQ(root.get<int>("g_health"), 75);
+  sq_poptop(vm);
+}
+
+TEST(SquipFieldRef, unrelated_class)
+{
+  squip::SquirrelVM sqvm;
+  HSQUIRRELVM vm = sqvm.get_vm();
+
+  squip::compile_and_run(vm,
+                         "class Point { x = 1; y = 2; z = 3; };"
+                         "class Other { a = 1; };"
+                         "g_other <- Other();"
+                         "g_table <- {};",
+                         "<source>");
+
+  squip::TableContext root = sqvm.stack().push_roottable();
+  root.get_entry("Point");
+  squip::FieldRef const z_field(vm, -1, "z");
+  EXPECT_EQ(z_field.get<int>(vm, -1), 3);
+  sq_poptop(vm);
+
+  // the handle indexes past the members of Other
+  root.get_entry("g_other");
+  EXPECT_THROW(z_field.get<int>(vm, -1), squip::SquirrelError);
+  EXPECT_THROW(z_field.set(vm, -1, 5), squip::SquirrelError);
+  ASSERT_EQ(sq_gettop(vm), 2);
+  sq_poptop(vm);
+
+  root.get_entry("g_table");
+  EXPECT_THROW(z_field.get<int>(vm, -1), squip::SquirrelError);
+  ASSERT_EQ(sq_gettop(vm), 2);
+  sq_poptop(vm);
+
+  // a value of the wrong type doesn't stay on the stack
+  root.get_entry("Point");
+  EXPECT_THROW(z_field.get<std::string>(vm, -1), squip::SquirrelError);
+  ASSERT_EQ(sq_gettop(vm), 2);
+  sq_pop(vm, 2);
+}
+
+/* EOF */
@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <tuple>
+
+#include <squip/fields.hpp>
+#include <squip/squirrel_vm.hpp>
+#include <squip/table_context.hpp>
+#include <squip/util.hpp>
+
+namespace {
+
+struct Vec2
+{
+  float x;
+  double y;
+};
+
+struct Sprite
+{
+  std::string name;
+  Vec2 pos;
+  int layer;
+  bool visible;
+};
+
+} // namespace
+
+template<>
+struct squip::fields<Vec2>
+{
+  static constexpr auto value = std::make_tuple(squip::field("x", &Vec2::x),
+                                                squip::field("y", &Vec2::y));
+};
+
+template<>
+struct squip::fields<Sprite>
+{
+  static constexpr auto value = std::make_tuple(squip::field("name", &Sprite::name),
+                                                squip::field("pos", &Sprite::pos),
+                                                squip::field("layer", &Sprite::layer),
+                                                squip::field("visible", &Sprite::visible));
+};
+
+TEST(SquipFields, roundtrip)
+{
+  squip::SquirrelVM sqvm;
+  HSQUIRRELVM vm = sqvm.get_vm();
+
+  Sprite const sprite{"tux", Vec2{1.5f, -2.0}, 3, true};
+  squip::push_value(vm, sprite);
+  EXPECT_EQ(sq_getsize(vm, -1), 4);
+
+  Sprite const result = squip::unpack<Sprite>(vm, -1);
+  EXPECT_EQ(result.name, "tux");
+  EXPECT_EQ(result.pos.x, 1.5f);
+  EXPECT_EQ(result.pos.y, -2.0);
+  EXPECT_EQ(result.layer, 3);
+  EXPECT_EQ(result.visible, true);
+  sq_poptop(vm);
+
+  ASSERT_EQ(sq_gettop(vm), 0);
+}
+
+TEST(SquipFields, script)
+{
+  squip::SquirrelVM sqvm;
+  HSQUIRRELVM vm = sqvm.get_vm();
+
+  squip::compile_and_run(vm, "g_pos <- { x = 4, y = 0.5 }; g_bad <- { x = 1 };", "<source>");
+
+  squip::TableContext root = sqvm.stack().push_roottable();
+  Vec2 const pos = root.get<Vec2>("g_pos");
+  EXPECT_EQ(pos.x, 4.0f);
+  EXPECT_EQ(pos.y, 0.5);
+  EXPECT_THROW(root.get<Vec2>("g_bad"), squip::SquirrelError);
+  sq_settop(vm, 0);
+}
+
+TEST(SquipFields, try_unpack)
+{
+  squip::SquirrelVM sqvm;
+  HSQUIRRELVM vm = sqvm.get_vm();
+
+  squip::compile_and_run(vm, "g_pos <- { x = 4, y = 0.5 }; g_bad <- { x = 1, y = \"y\" };", "<source>");
+
+  squip::TableContext root = sqvm.stack().push_roottable();
+  EXPECT_EQ(root.try_get<Vec2>("g_pos").value_or(Vec2{}).y, 0.5);
+  EXPECT_FALSE(root.try_get<Vec2>("g_bad"));
+  EXPECT_FALSE(root.try_get<Vec2>("g_missing"));
+  EXPECT_EQ(sq_gettop(vm), 1);
+
+  sq_pushinteger(vm, 5);
+  EXPECT_FALSE(squip::try_unpack<Vec2>(vm, -1));
+  EXPECT_EQ(sq_gettop(vm), 2);
+  sq_settop(vm, 0);
+}
+
+/* EOF */
@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <squip/json_parser.hpp>
+#include <squip/json_writer.hpp>
+#include <squip/squirrel_vm.hpp>
+#include <squip/stack_context.hpp>
+#include <squip/table_context.hpp>
+#include <squip/util.hpp>
+
+TEST(SquipJsonParser, parse_json)
+{
+  squip::SquirrelVM sqvm;
+  HSQUIRRELVM vm = sqvm.get_vm();
+
+  squip::parse_json(vm, " [1, -2.5, 1e2, true, false, null, \"a\\u00e9\\n\", [], {}] ");
+  EXPECT_EQ(sq_gettop(vm), 1);
+  EXPECT_EQ(sq_getsize(vm, -1), 9);
+  EXPECT_EQ(squip::to_json(vm, -1), "[1,-2.5,100,true,false,null,\"a\xc3\xa9\\n\",[],{}]");
+  sq_poptop(vm);
+
+  squip::parse_json(vm, "\"\\ud83d\\ude00\"");
+  EXPECT_EQ(squip::unpack<std::string>(vm, -1), "\xf0\x9f\x98\x80");
+  sq_poptop(vm);
+
+  squip::parse_json(vm, "123456789012");
+  EXPECT_EQ(sq_gettype(vm, -1), OT_INTEGER);
+  EXPECT_EQ(squip::unpack<SQInteger>(vm, -1), 123456789012);
+  sq_poptop(vm);
+}
+
+TEST(SquipJsonParser, stack_context)
+{
+  squip::SquirrelVM sqvm;
+  HSQUIRRELVM vm = sqvm.get_vm();
+
+  std::string text = "[";
+  for (int i = 0; i < 1000; ++i) {
+    text += (i == 0) ? "" : ",";
+    text += "{\"id\":" + std::to_string(i) + ",\"name\":\"entry\"}";
+  }
+  text += "]";
+
+  sqvm.stack().push_json(text);
+  ASSERT_EQ(sq_gettop(vm), 1);
+  EXPECT_EQ(sq_getsize(vm, -1), 1000);
+
+  sq_pushinteger(vm, 999);
+  ASSERT_TRUE(SQ_SUCCEEDED(sq_get(vm, -2)));
+  {
+    squip::TableContext entry(vm, -1);
+    EXPECT_EQ(entry.get<SQInteger>("id"), 999);
+    EXPECT_EQ(entry.get<std::string>("name"), "entry");
+  }
+  sq_settop(vm, 0);
+}
+
+TEST(SquipJsonParser, errors)
+{
+  squip::SquirrelVM sqvm;
+  HSQUIRRELVM vm = sqvm.get_vm();
+
+  std::vector<std::string> const invalid = {
+    "", "[", "[1,]", "{\"a\" 1}", "{1:2}", "01", "1.", "-", "tru",
+    "\"abc", "\"\\x\"", "\"\\ud800\"", "[1] 2", "\"a\nb\"",
+    std::string(2000, '[')
+  };
+
+  sq_pushinteger(vm, 5);
+  for (auto const& text : invalid) {
+    EXPECT_THROW(squip::parse_json(vm, text), std::runtime_error) << text;
+    EXPECT_EQ(sq_gettop(vm), 1) << text;
+  }
+  sq_poptop(vm);
+}
+
+TEST(SquipJsonParser, script)
+{
+  squip::SquirrelVM sqvm;
+  HSQUIRRELVM vm = sqvm.get_vm();
+
+  {
+    squip::TableContext root = sqvm.stack().push_roottable();
+    squip::register_json_parser(root);
+    sq_poptop(vm);
+  }
+
+  squip::compile_and_run(vm,
+                         "local v = parse_json(\"{\\\"xs\\\": [1, 2, 3], \\\"name\\\": \\\"test\\\"}\");"
+                         "g_sum <- v.xs[0] + v.xs[1] + v.xs[2];"
+                         "g_name <- v.name;",
+                         "<source>");
+
+  squip::TableContext root = sqvm.stack().push_roottable();
+  EXPECT_EQ(root.get<SQInteger>("g_sum"), 6);
+  EXPECT_EQ(root.get<std::string>("g_name"), "test");
+  sq_poptop(vm);
+}
+
+/* EOF */
@@ -0,0 +1,155 @@
+#include <gtest/gtest.h>
+
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <squip/json_parser.hpp>
+#include <squip/json_writer.hpp>
+#include <squip/squirrel_vm.hpp>
+#include <squip/util.hpp>
+
+TEST(SquipJsonWriter, scalars)
+{
+  squip::SquirrelVM sqvm;
+  HSQUIRRELVM vm = sqvm.get_vm();
+
+  sq_pushnull(vm);
+  sq_pushbool(vm, SQTrue);
+  sq_pushinteger(vm, -42);
+  sq_pushfloat(vm, 0.5f);
+  sq_pushfloat(vm, std::numeric_limits<SQFloat>::infinity());
+  sq_pushstring(vm, "a\"b\\c\n\x01", -1);
+
+  EXPECT_EQ(squip::to_json(vm, 1), "null");
+  EXPECT_EQ(squip::to_json(vm, 2), "true");
+  EXPECT_EQ(squip::to_json(vm, 3), "-42");
+  EXPECT_EQ(squip::to_json(vm, 4), "0.5");
+  EXPECT_EQ(squip::to_json(vm, 5), "null");
+  EXPECT_EQ(squip::to_json(vm, 6), "\"a\\\"b\\\\c\\n\\u0001\"");
+  ASSERT_EQ(sq_gettop(vm), 6);
+
+  sq_settop(vm, 0);
+}
+
+TEST(SquipJsonWriter, containers)
+{
+  squip::SquirrelVM sqvm;
+  HSQUIRRELVM vm = sqvm.get_vm();
+
+  sq_newtable(vm);
+  sq_pushstring(vm, "values", -1);
+  sq_newarray(vm, 0);
+  for (SQInteger i = 1; i <= 3; ++i) {
+    sq_pushinteger(vm, i);
+    sq_arrayappend(vm, -2);
+  }
+  sq_newslot(vm, -3, SQFalse);
+
+  EXPECT_EQ(squip::to_json(vm, -1), "{\"values\":[1,2,3]}");
+  EXPECT_EQ(squip::to_json(vm, -1, true),
+            "{\n"
+            "  \"values\": [\n"
+            "    1,\n"
+            "    2,\n"
+            "    3\n"
+            "  ]\n"
+            "}\n");
+
+  sq_newarray(vm, 0);
+  sq_newtable(vm);
+  sq_arrayappend(vm, -2);
+  EXPECT_EQ(squip::to_json(vm, -1), "[{}]");
+  EXPECT_EQ(squip::to_json(vm, -1, true), "[\n  {}\n]\n");
+  ASSERT_EQ(sq_gettop(vm), 2);
+
+  sq_settop(vm, 0);
+}
+
+TEST(SquipJsonWriter, float_round_trip)
+{
+  squip::SquirrelVM sqvm;
+  HSQUIRRELVM vm = sqvm.get_vm();
+
+  sq_pushfloat(vm, 2.0f);
+  sq_pushfloat(vm, -100.0f);
+  sq_pushfloat(vm, 1.0e30f);
+  EXPECT_EQ(squip::to_json(vm, 1), "2.0");
+  EXPECT_EQ(squip::to_json(vm, 2), "-100.0");
+
+  // integral floats must come back as floats, not integers
+  for (SQInteger idx = 1; idx <= 3; ++idx) {
+    std::string const json = squip::to_json(vm, idx);
+    squip::parse_json(vm, json);
+    EXPECT_EQ(sq_gettype(vm, -1), OT_FLOAT) << json;
+    SQFloat original;
+    SQFloat parsed;
+    sq_getfloat(vm, idx, &original);
+    sq_getfloat(vm, -1, &parsed);
+    EXPECT_EQ(parsed, original) << json;
+    sq_poptop(vm);
+  }
+  ASSERT_EQ(sq_gettop(vm), 3);
+
+  sq_settop(vm, 0);
+}
+
+TEST(SquipJsonWriter, chunks)
+{
+  squip::SquirrelVM sqvm;
+  HSQUIRRELVM vm = sqvm.get_vm();
+
+  sq_newarray(vm, 0);
+  for (SQInteger i = 0; i < 1000; ++i) {
+    sq_pushstring(vm, "0123456789", -1);
+    sq_arrayappend(vm, -2);
+  }
+
+  std::vector<size_t> chunks;
+  std::string result;
+  squip::JsonWriter writer([&](std::string_view data) {
+    chunks.push_back(data.size());
+    result.append(data);
+  }, false, 256);
+  writer.write(vm, -1);
+
+  EXPECT_EQ(result, squip::to_json(vm, -1));
+  EXPECT_GT(chunks.size(), 1u);
+  for (size_t const size : chunks) {
+    EXPECT_LT(size, 256u + 16u);
+  }
+
+  sq_poptop(vm);
+}
+
+TEST(SquipJsonWriter, errors)
+{
+  squip::SquirrelVM sqvm;
+  HSQUIRRELVM vm = sqvm.get_vm();
+
+  // table that contains itself
+  sq_newtable(vm);
+  sq_pushstring(vm, "self", -1);
+  sq_push(vm, -2);
+  sq_newslot(vm, -3, SQFalse);
+  EXPECT_THROW(squip::to_json(vm, -1), std::runtime_error);
+  ASSERT_EQ(sq_gettop(vm), 1);
+
+  // the same table twice is not a cycle
+  sq_newarray(vm, 0);
+  sq_newarray(vm, 0);
+  sq_push(vm, -1);
+  sq_arrayappend(vm, -3);
+  sq_arrayappend(vm, -2);
+  EXPECT_EQ(squip::to_json(vm, -1), "[[],[]]");
+
+  sq_pushuserpointer(vm, nullptr);
+  EXPECT_THROW(squip::to_json(vm, -1), std::runtime_error);
+  ASSERT_EQ(sq_gettop(vm), 3);
+
+  sq_settop(vm, 0);
+}
+
+/* EOF */
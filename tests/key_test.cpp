@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <string_view>
+
+#include <squip/key.hpp>
+#include <squip/squirrel_vm.hpp>
+#include <squip/table_context.hpp>
+#include <squip/util.hpp>
+
+using namespace squip::literals;
+
+namespace {
+
+constexpr squip::KeyLiteral key_name_x = "x"_key;
+
+} // namespace
+
+TEST(SquipKey, key)
+{
+  squip::SquirrelVM sqvm;
+  HSQUIRRELVM vm = sqvm.get_vm();
+
+  squip::Key const key_x(vm, key_name_x);
+  squip::Key const key_y(vm, "y");
+  EXPECT_EQ(key_x.get_name(), "x");
+  EXPECT_EQ(key_x.get_handle()._type, OT_STRING);
+
+  squip::TableContext table = sqvm.stack().push_new_table();
+  EXPECT_FALSE(table.has_key(key_x));
+
+  table.store(key_x, 5);
+  table.store("y", 7);
+  EXPECT_TRUE(table.has_key(key_x));
+  EXPECT_TRUE(table.has_key("x"));
+  EXPECT_EQ(table.get<int>(key_x), 5);
+  EXPECT_EQ(table.get<int>(key_y), 7);
+
+  int value = 0;
+  EXPECT_TRUE(table.read(key_y, value));
+  EXPECT_EQ(value, 7);
+
+  table.delete_entry(key_x);
+  EXPECT_FALSE(table.has_key(key_x));
+  EXPECT_THROW(table.get<int>(key_x), squip::SquirrelError);
+
+  table.store(key_y, 7);
+  squip::Key const key_z(vm, "z");
+  table.rename_entry(key_y, key_z);
+  EXPECT_FALSE(table.has_key(key_y));
+  EXPECT_EQ(table.get<int>(key_z), 7);
+
+  squip::Key const key_sub(vm, "sub");
+  table.create_or_get_table(key_sub).store(key_x, 1);
+  sq_poptop(vm);
+  EXPECT_EQ(table.create_or_get_table(key_sub).get<int>(key_x), 1);
+  sq_poptop(vm);
+
+  sqvm.stack().push(key_y);
+  EXPECT_EQ(squip::unpack<std::string>(vm, -1), "y");
+  sq_pop(vm, 2);
+  ASSERT_EQ(sq_gettop(vm), 0);
+}
+
+TEST(SquipKey, literal)
+{
+  squip::SquirrelVM sqvm;
+  HSQUIRRELVM vm = sqvm.get_vm();
+
+  // each literal is interned once per SquirrelVM
+  squip::Key const* const key_x = "x"_key.resolve(vm);
+  ASSERT_NE(key_x, nullptr);
+  EXPECT_EQ(key_x->get_name(), "x");
+  EXPECT_EQ(key_name_x.resolve(vm), key_x);
+  EXPECT_NE("y"_key.resolve(vm), key_x);
+
+  squip::TableContext table = sqvm.stack().push_new_table();
+  table.store("x"_key, 5);
+  EXPECT_TRUE(table.has_key("x"));
+  EXPECT_EQ(table.get<int>("x"_key), 5);
+
+  table.rename_entry("x"_key, "y"_key);
+  EXPECT_FALSE(table.has_key("x"_key));
+  EXPECT_EQ(table.try_get<int>("y"_key), 5);
+
+  table.create_or_get_table("sub"_key).store("z"_key, 1);
+  sq_poptop(vm);
+  EXPECT_EQ(table.create_or_get_table("sub"_key).get<int>("z"_key), 1);
+  sq_poptop(vm);
+  sq_poptop(vm);
+
+  // VMs not owned by a SquirrelVM push the name as string
+  HSQUIRRELVM const plain = sq_open(64);
+  EXPECT_EQ("x"_key.resolve(plain), nullptr);
+  "x"_key.push(plain);
+  EXPECT_EQ(squip::unpack<std::string>(plain, -1), "x");
+  sq_poptop(plain);
+  sq_close(plain);
+
+  ASSERT_EQ(sq_gettop(vm), 0);
+}
+
+/* EOF */
@@ -0,0 +1,44 @@
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <unistd.h>
+
+#include <squip/mapped_file.hpp>
+
+TEST(SquipMappedFile, read)
+{
+  std::ifstream fin("tests/thread1.nut", std::ios::binary);
+  std::ostringstream expected;
+  expected << fin.rdbuf();
+
+  squip::MappedFile file("tests/thread1.nut");
+  EXPECT_EQ(file.size(), expected.str().size());
+  EXPECT_EQ(file.get_text(), expected.str());
+
+  squip::MappedFile moved = std::move(file);
+  EXPECT_EQ(file.size(), 0);
+  EXPECT_EQ(moved.get_text(), expected.str());
+
+  EXPECT_THROW(squip::MappedFile("tests/does_not_exist.nut"), std::runtime_error);
+}
+
+TEST(SquipMappedFile, pipe)
+{
+  int fds[2];
+  ASSERT_EQ(::pipe(fds), 0);
+
+  std::string const text = "print(\"from a pipe\")";
+  ASSERT_EQ(::write(fds[1], text.data(), text.size()), static_cast<ssize_t>(text.size()));
+  ::close(fds[1]);
+
+  // pipes report a size of zero and can't be mapped
+  squip::MappedFile file("/proc/self/fd/" + std::to_string(fds[0]));
+  ::close(fds[0]);
+  EXPECT_EQ(file.size(), text.size());
+  EXPECT_EQ(file.get_text(), text);
+}
+
+/* EOF */
@@ -0,0 +1,55 @@
+#include <gtest/gtest.h>
+
+#include <squip/module_loader.hpp>
+#include <squip/squirrel_error.hpp>
+#include <squip/squirrel_vm.hpp>
+#include <squip/table_context.hpp>
+#include <squip/util.hpp>
+
+TEST(SquipModuleLoader, require)
+{
+  squip::SquirrelVM sqvm;
+  HSQUIRRELVM vm = sqvm.get_vm();
+
+  squip::ModuleLoader loader(sqvm);
+  loader.add_search_path("tests/modules");
+  {
+    squip::TableContext root = sqvm.stack().push_roottable();
+    loader.store_require(root);
+    sq_poptop(vm);
+  }
+
+  squip::compile_and_run(vm, "g_load_count <- 0", "<source>");
+  EXPECT_FALSE(loader.is_loaded("math_utils"));
+
+  squip::compile_and_run(vm,
+                         "local m = require(\"math_utils\");"
+                         "g_result <- m.square(5) + m.pi;"
+                         "g_same <- (m == require(\"math_utils\"));"
+                         "g_answer <- require(\"answer\").value;",
+                         "<source>");
+  EXPECT_TRUE(loader.is_loaded("math_utils"));
+  EXPECT_TRUE(loader.is_loaded("answer"));
+
+  {
+    squip::TableContext root = sqvm.stack().push_roottable();
+    EXPECT_EQ(root.get<int>("g_load_count"), 1);
+    EXPECT_EQ(root.get<int>("g_result"), 28);
+    EXPECT_EQ(root.get<bool>("g_same"), true);
+    EXPECT_EQ(root.get<int>("g_answer"), 42);
+    // module definitions do not leak into the roottable
+    EXPECT_FALSE(root.has_key("square"));
+    sq_poptop(vm);
+  }
+
+  loader.require(vm, "math_utils");
+  EXPECT_EQ(sq_gettype(vm, -1), OT_TABLE);
+  sq_poptop(vm);
+
+  EXPECT_THROW(squip::compile_and_run(vm, "require(\"does_not_exist\")", "<source>"),
+               squip::SquirrelError);
+  EXPECT_FALSE(loader.is_loaded("does_not_exist"));
+  ASSERT_EQ(sq_gettop(vm), 0);
+}
+
+/* EOF */
@@ -0,0 +1,7 @@
+local math_utils = require("math_utils")
+
+return {
+    value = math_utils.square(6) + 6
+}
+
+/* EOF */
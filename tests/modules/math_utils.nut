@@ -0,0 +1,9 @@
+::g_load_count += 1
+
+function square(x) {
+    return x * x
+}
+
+pi <- 3
+
+/* EOF */
@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+
+#include <limits>
+
+#include <squip/class_binding.hpp>
+#include <squip/numeric_array.hpp>
+#include <squip/squirrel_error.hpp>
+#include <squip/squirrel_vm.hpp>
+#include <squip/table_context.hpp>
+#include <squip/util.hpp>
+
+TEST(SquipNumericArray, kernels)
+{
+  squip::Float32Array a(5);
+  squip::Float32Array b(5);
+  for (SQInteger i = 0; i < 5; ++i) {
+    a.set(i, static_cast<float>(i));
+    b.set(i, 2.0f);
+  }
+
+  a.add(b);
+  EXPECT_EQ(a.sum(), 20.0);
+  a.mul(b);
+  EXPECT_EQ(a.get(4), 12.0f);
+  a.fma(b, b);
+  EXPECT_EQ(a.get(0), 8.0f);
+  EXPECT_EQ(a.dot(b), 2.0 * (8 + 10 + 12 + 14 + 16));
+  a.clamp(9.0f, 13.0f);
+  EXPECT_EQ(a.get(0), 9.0f);
+  EXPECT_EQ(a.get(4), 13.0f);
+
+  EXPECT_THROW(a.get(5), std::out_of_range);
+  EXPECT_THROW(a.add(squip::Float32Array(3)), std::invalid_argument);
+
+  squip::Int32Array ints(100);
+  ints.fill(2000000000);
+  EXPECT_EQ(ints.sum(), 200000000000);
+}
+
+TEST(SquipNumericArray, int32_extremes)
+{
+  int32_t const min = std::numeric_limits<int32_t>::min();
+  int32_t const max = std::numeric_limits<int32_t>::max();
+
+  squip::Int32Array a(1);
+  a.set(0, min);
+  EXPECT_EQ(a.dot(a), SQInteger{1} << 62);
+
+  squip::Int32Array b(2);
+  b.fill(min);
+  b.set(1, max);
+  EXPECT_EQ(b.dot(b), (SQInteger{1} << 62) + (SQInteger{max} * max));
+  EXPECT_EQ(b.sum(), -1);
+
+  // 2 * 2^62 doesn't fit into SQInteger and wraps around
+  b.fill(min);
+  EXPECT_EQ(b.dot(b), std::numeric_limits<SQInteger>::min());
+}
+
+TEST(SquipNumericArray, script)
+{
+  squip::SquirrelVM sqvm;
+  HSQUIRRELVM vm = sqvm.get_vm();
+
+  {
+    squip::TableContext root = sqvm.stack().push_roottable();
+    squip::register_numeric_arrays(root);
+    sq_poptop(vm);
+  }
+
+  squip::compile_and_run(vm,
+                         "local a = Float32Array(4);"
+                         "local b = Float32Array(4);"
+                         "for (local i = 0; i < 4; ++i) { a[i] = i; b.set(i, 0.5); }"
+                         "a.add(1);"
+                         "a.mul(b);"
+                         "a.fma(b, 2);"
+                         "g_sum <- a.sum();"
+                         "g_dot <- a.dot(b);"
+                         "g_len <- a.len();"
+                         "g_elem <- a[3];"
+                         "g_array <- a.to_array();"
+                         "local ints = Int32Array(3);"
+                         "ints.fill(7);"
+                         "g_int_sum <- ints.sum();"
+                         "local d = Float64Array(2);"
+                         "d.fill(0.25);"
+                         "d.clamp(0.5, 1.0);"
+                         "g_double_sum <- d.sum();",
+                         "<source>");
+
+  {
+    squip::TableContext root = sqvm.stack().push_roottable();
+    // a = (i + 1) * 0.5 + 1.0 = [1.5, 2, 2.5, 3]
+    EXPECT_FLOAT_EQ(root.get<float>("g_sum"), 9.0f);
+    EXPECT_FLOAT_EQ(root.get<float>("g_dot"), 4.5f);
+    EXPECT_EQ(root.get<int>("g_len"), 4);
+    EXPECT_FLOAT_EQ(root.get<float>("g_elem"), 3.0f);
+    EXPECT_EQ(root.get<std::vector<SQFloat>>("g_array"), (std::vector<SQFloat>{1.5f, 2.0f, 2.5f, 3.0f}));
+    EXPECT_EQ(root.get<int>("g_int_sum"), 21);
+    EXPECT_FLOAT_EQ(root.get<float>("g_double_sum"), 1.0f);
+
+    root.get_entry("g_array");
+    EXPECT_EQ(squip::ClassBinding<squip::Float32Array>::get_instance(vm, -1), nullptr);
+    sq_pop(vm, 2);
+  }
+
+  EXPECT_THROW(squip::compile_and_run(vm, "Float32Array(2).add(Int32Array(2));", "<source>"),
+               squip::SquirrelError);
+  EXPECT_THROW(squip::compile_and_run(vm, "Float32Array(2).add(Float32Array(3));", "<source>"),
+               squip::SquirrelError);
+  EXPECT_THROW(squip::compile_and_run(vm, "Float32Array(2)[2];", "<source>"),
+               squip::SquirrelError);
+  sq_settop(vm, 0);
+}
+
+/* EOF */
@@ -0,0 +1,59 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include <squip/precompile.hpp>
+#include <squip/squirrel_error.hpp>
+#include <squip/squirrel_vm.hpp>
+#include <squip/util.hpp>
+
+TEST(SquipPrecompile, precompile_files)
+{
+  std::filesystem::path const directory = std::filesystem::temp_directory_path() / "squip_precompile_test";
+  std::filesystem::remove_all(directory);
+  std::filesystem::create_directories(directory);
+
+  std::vector<std::filesystem::path> paths;
+  for (int i = 0; i < 32; ++i) {
+    paths.emplace_back(directory / ("script" + std::to_string(i) + ".nut"));
+    std::ofstream(paths.back()) << "g_sum <- g_sum + " << i;
+  }
+
+  std::vector<std::vector<std::byte>> const results = squip::precompile_files(paths, 4);
+  ASSERT_EQ(results.size(), paths.size());
+
+  squip::SquirrelVM sqvm;
+  HSQUIRRELVM vm = sqvm.get_vm();
+  squip::compile_and_run(vm, "g_sum <- 0", "<source>");
+
+  for (size_t i = 0; i < results.size(); ++i) {
+    squip::read_closure(vm, results[i]);
+    squip::run_closure(vm, paths[i].string());
+  }
+
+  squip::compile_files(vm, paths);
+  ASSERT_EQ(sq_gettop(vm), static_cast<SQInteger>(paths.size()));
+  for (size_t i = 0; i < paths.size(); ++i) {
+    sq_push(vm, 1);
+    sq_remove(vm, 1);
+    squip::run_closure(vm, paths[i].string());
+  }
+  ASSERT_EQ(sq_gettop(vm), 0);
+
+  {
+    squip::TableContext root = sqvm.stack().push_roottable();
+    EXPECT_EQ(root.get<int>("g_sum"), 2 * (31 * 32 / 2));
+    sq_poptop(vm);
+  }
+
+  std::ofstream(paths[7]) << "g_sum <- (";
+  EXPECT_THROW(squip::precompile_files(paths), squip::SquirrelError);
+  EXPECT_THROW(squip::compile_files(vm, paths), squip::SquirrelError);
+  ASSERT_EQ(sq_gettop(vm), 0);
+
+  std::filesystem::remove_all(directory);
+}
+
+/* EOF */
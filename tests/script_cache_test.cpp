@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <sstream>
+
+#include <squip/script_cache.hpp>
+#include <squip/squirrel_vm.hpp>
+#include <squip/util.hpp>
+
+namespace {
+
+std::filesystem::path make_cache_directory(std::string const& name)
+{
+  std::filesystem::path const directory = std::filesystem::temp_directory_path() / name;
+  std::filesystem::remove_all(directory);
+  return directory;
+}
+
+} // namespace
+
+TEST(SquipScriptCache, compile_buffer)
+{
+  std::filesystem::path const directory = make_cache_directory("squip_script_cache_test");
+
+  for (int i = 0; i < 2; ++i) {
+    squip::SquirrelVM sqvm;
+    HSQUIRRELVM vm = sqvm.get_vm();
+
+    std::ostringstream out;
+    sqvm.set_printfunc([&out](char const* msg){ out << msg; },
+                       [&out](char const* msg){ out << msg; });
+
+    squip::ScriptCache cache(directory);
+    cache.compile_buffer(vm, "print(\"HelloWorld\\n\")", "<source>");
+    squip::run_closure(vm, "<source>");
+    ASSERT_EQ(sq_gettop(vm), 0);
+    EXPECT_EQ(out.str(), "HelloWorld\n");
+
+    // first round fills the cache, second round loads from it
+    EXPECT_EQ(cache.get_hits(), static_cast<uint64_t>(i));
+    EXPECT_EQ(cache.get_misses(), static_cast<uint64_t>(1 - i));
+  }
+
+  {
+    squip::SquirrelVM sqvm;
+    squip::ScriptCache cache(directory);
+
+    // different source or sourcename must not hit the cache
+    cache.compile_buffer(sqvm.get_vm(), "print(\"HelloWorld\\n\") ", "<source>");
+    sq_poptop(sqvm.get_vm());
+    cache.compile_buffer(sqvm.get_vm(), "print(\"HelloWorld\\n\")", "<other>");
+    sq_poptop(sqvm.get_vm());
+    EXPECT_EQ(cache.get_hits(), 0u);
+    EXPECT_EQ(cache.get_misses(), 2u);
+
+    cache.clear();
+    EXPECT_TRUE(std::filesystem::is_empty(directory));
+  }
+
+  {
+    squip::SquirrelVM sqvm;
+    squip::ScriptCache cache(directory);
+
+    // bytecode compiled with a different debug info setting must not be reused
+    cache.compile_buffer(sqvm.get_vm(), "print(\"HelloWorld\\n\")", "<source>");
+    sq_poptop(sqvm.get_vm());
+    sq_enabledebuginfo(sqvm.get_vm(), SQTrue);
+    cache.compile_buffer(sqvm.get_vm(), "print(\"HelloWorld\\n\")", "<source>");
+    sq_poptop(sqvm.get_vm());
+    EXPECT_EQ(cache.get_hits(), 0u);
+    EXPECT_EQ(cache.get_misses(), 2u);
+  }
+
+  std::filesystem::remove_all(directory);
+}
+
+TEST(SquipScriptCache, run_script)
+{
+  std::filesystem::path const directory = make_cache_directory("squip_script_cache_thread_test");
+
+  for (int i = 0; i < 2; ++i) {
+    squip::SquirrelVM sqvm;
+    sqvm.set_script_cache(directory);
+
+    std::ostringstream out;
+    sqvm.set_printfunc([&out](char const* msg){ out << msg; },
+                       [&out](char const* msg){ out << msg; });
+
+    squip::compile_and_run(sqvm.get_vm(), "g_counter <- 0", "<source>");
+
+    squip::Thread thread = sqvm.create_thread();
+    thread.run_script("tests/thread1.nut");
+    while (thread.is_suspended()) {
+      thread.wakeup();
+    }
+
+    EXPECT_TRUE(out.str().starts_with("Hello, World from thread number one!\n"
+                                      "0 --- Thread1: 0\n"));
+    EXPECT_EQ(sqvm.get_script_cache()->get_hits(), static_cast<uint64_t>(i));
+  }
+
+  std::filesystem::remove_all(directory);
+}
+
+/* EOF */
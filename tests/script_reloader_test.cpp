@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+
+#include <squip/module_loader.hpp>
+#include <squip/script_reloader.hpp>
+#include <squip/squirrel_vm.hpp>
+#include <squip/table_context.hpp>
+#include <squip/util.hpp>
+
+TEST(SquipScriptReloader, poll)
+{
+  std::filesystem::path const directory = std::filesystem::temp_directory_path() / "squip_script_reloader_test";
+  std::filesystem::remove_all(directory);
+  std::filesystem::create_directories(directory);
+
+  std::ofstream(directory / "config.nut") << "function get_value() { return 1 }";
+  std::ofstream(directory / "other.nut") << "value <- 5";
+
+  squip::SquirrelVM sqvm;
+  HSQUIRRELVM vm = sqvm.get_vm();
+
+  {
+    squip::ModuleLoader loader(sqvm);
+    loader.add_search_path(directory);
+    {
+      squip::TableContext root = sqvm.stack().push_roottable();
+      loader.store_require(root);
+      sq_poptop(vm);
+    }
+
+    squip::compile_and_run(vm,
+                           "g_config <- require(\"config\");"
+                           "g_other <- require(\"other\");",
+                           "<source>");
+
+    squip::ScriptReloader reloader(loader);
+    EXPECT_TRUE(reloader.poll(vm).empty());
+
+    std::ofstream(directory / "config.nut") << "function get_value() { return 2 }";
+
+    std::vector<squip::ReloadReport> reports = reloader.poll(vm);
+    ASSERT_EQ(reports.size(), 1u);
+    EXPECT_EQ(reports[0].module, "config");
+    EXPECT_TRUE(reports[0].success);
+    EXPECT_GE(reports[0].duration.count(), 0);
+
+    // the old export table got updated in place
+    squip::compile_and_run(vm, "g_value <- g_config.get_value()", "<source>");
+    {
+      squip::TableContext root = sqvm.stack().push_roottable();
+      EXPECT_EQ(root.get<int>("g_value"), 2);
+      sq_poptop(vm);
+    }
+
+    // a broken module leaves the previous version in place
+    std::ofstream(directory / "config.nut") << "function get_value() { return 3 ";
+    reports = reloader.poll(vm);
+    ASSERT_EQ(reports.size(), 1u);
+    EXPECT_FALSE(reports[0].success);
+    EXPECT_FALSE(reports[0].error.empty());
+
+    squip::compile_and_run(vm, "g_value <- g_config.get_value()", "<source>");
+    {
+      squip::TableContext root = sqvm.stack().push_roottable();
+      EXPECT_EQ(root.get<int>("g_value"), 2);
+      sq_poptop(vm);
+    }
+
+    // modules are watched as soon as they are loaded, so edits before
+    // the next poll() are not missed
+    std::filesystem::create_directories(directory / "late");
+    std::ofstream(directory / "late" / "late.nut") << "value <- 1";
+    loader.add_search_path(directory / "late");
+    squip::compile_and_run(vm, "g_late <- require(\"late\");", "<source>");
+    std::ofstream(directory / "late" / "late.nut") << "value <- 2";
+    reports = reloader.poll(vm);
+    ASSERT_EQ(reports.size(), 1u);
+    EXPECT_EQ(reports[0].module, "late");
+    EXPECT_TRUE(reports[0].success);
+
+    // files that are not modules are ignored
+    std::ofstream(directory / "unrelated.nut") << "";
+    EXPECT_TRUE(reloader.poll(vm).empty());
+    ASSERT_EQ(sq_gettop(vm), 0);
+  }
+
+  std::filesystem::remove_all(directory);
+}
+
+/* EOF */
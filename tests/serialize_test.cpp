@@ -0,0 +1,190 @@
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <filesystem>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <squip/serialize.hpp>
+#include <squip/squirrel_vm.hpp>
+#include <squip/table_context.hpp>
+#include <squip/util.hpp>
+
+namespace {
+
+void push_global(squip::SquirrelVM& sqvm, char const* name)
+{
+  sqvm.stack().push_roottable();
+  sq_pushstring(sqvm.get_vm(), name, -1);
+  ASSERT_TRUE(SQ_SUCCEEDED(sq_get(sqvm.get_vm(), -2)));
+  sq_remove(sqvm.get_vm(), -2);
+}
+
+} // namespace
+
+TEST(SquipSerialize, round_trip)
+{
+  std::vector<std::byte> data;
+
+  {
+    squip::SquirrelVM sqvm;
+    HSQUIRRELVM vm = sqvm.get_vm();
+
+    squip::compile_and_run(vm,
+                           "g_state <- {"
+                           "  name = \"player\", level = 12, negative = -123456789012, score = 0.25,"
+                           "  alive = true, dead = false, nothing = null,"
+                           "  items = [\"sword\", 1, [2, 3], { count = 5 }],"
+                           "  func = function() { return 1; },"
+                           "  friends = [ { name = \"a\", level = 1 }, { name = \"b\", level = 2 } ]"
+                           "};"
+                           "g_state[5] <- \"five\";",
+                           "<source>");
+
+    push_global(sqvm, "g_state");
+    squip::save_squirrel_table(vm, -1, data);
+    sq_poptop(vm);
+    ASSERT_EQ(sq_gettop(vm), 0);
+  }
+
+  squip::SquirrelVM sqvm;
+  HSQUIRRELVM vm = sqvm.get_vm();
+
+  squip::TableContext table = sqvm.stack().push_new_table();
+  EXPECT_EQ(squip::load_squirrel_table(vm, -1, data), data.size());
+  ASSERT_EQ(sq_gettop(vm), 1);
+
+  EXPECT_EQ(table.get<std::string>("name"), "player");
+  EXPECT_EQ(table.get<SQInteger>("level"), 12);
+  EXPECT_EQ(table.get<SQInteger>("negative"), -123456789012);
+  EXPECT_EQ(table.get<SQFloat>("score"), 0.25);
+  EXPECT_EQ(table.get<bool>("alive"), true);
+  EXPECT_EQ(table.get<bool>("dead"), false);
+  EXPECT_TRUE(table.has_key("nothing"));
+  EXPECT_FALSE(table.has_key("func"));
+
+  sq_pushinteger(vm, 5);
+  ASSERT_TRUE(SQ_SUCCEEDED(sq_get(vm, -2)));
+  EXPECT_EQ(squip::unpack<std::string>(vm, -1), "five");
+  sq_poptop(vm);
+
+  table.get_entry("items");
+  EXPECT_EQ(squip::to_repr(vm, -1), "[\"sword\", 1, [2, 3], {\"count\": 5}]");
+  sq_poptop(vm);
+
+  table.get_entry("friends");
+  EXPECT_EQ(sq_getsize(vm, -1), 2);
+  sq_poptop(vm);
+
+  sq_poptop(vm);
+}
+
+TEST(SquipSerialize, dedup_strings)
+{
+  squip::SquirrelVM sqvm;
+  HSQUIRRELVM vm = sqvm.get_vm();
+
+  squip::compile_and_run(vm,
+                         "g_one <- { entries = [ { some_long_key_name = \"some_long_value\" } ] };"
+                         "g_many <- { entries = [] };"
+                         "for (local i = 0; i < 100; ++i) {"
+                         "  g_many.entries.append({ some_long_key_name = \"some_long_value\" });"
+                         "}",
+                         "<source>");
+
+  std::vector<std::byte> one;
+  push_global(sqvm, "g_one");
+  squip::save_squirrel_table(vm, -1, one);
+  sq_poptop(vm);
+
+  std::vector<std::byte> many;
+  push_global(sqvm, "g_many");
+  squip::save_squirrel_table(vm, -1, many);
+  sq_poptop(vm);
+
+  // each repeated entry only costs a few bytes for the string references
+  EXPECT_LT(many.size(), one.size() + 99 * 8);
+}
+
+TEST(SquipSerialize, file)
+{
+  std::filesystem::path const path = std::filesystem::temp_directory_path() / "squip_serialize_test.sqt";
+
+  squip::SquirrelVM sqvm;
+  HSQUIRRELVM vm = sqvm.get_vm();
+
+  {
+    squip::TableContext table = sqvm.stack().push_new_table();
+    for (int i = 0; i < 10000; ++i) {
+      table.store("key" + std::to_string(i), i);
+    }
+    squip::save_squirrel_table(vm, -1, path);
+    sq_poptop(vm);
+  }
+
+  squip::TableContext table = sqvm.stack().push_new_table();
+  squip::load_squirrel_table(vm, -1, path);
+  EXPECT_EQ(sq_getsize(vm, -1), 10000);
+  EXPECT_EQ(table.get<int>("key9999"), 9999);
+
+  // a failed save must not clobber the existing file
+  sq_pushstring(vm, "self", -1);
+  sq_push(vm, -2);
+  sq_newslot(vm, -3, SQFalse);
+  EXPECT_THROW(squip::save_squirrel_table(vm, -1, path), std::runtime_error);
+  ASSERT_EQ(sq_gettop(vm), 1);
+  sq_poptop(vm);
+
+  sqvm.stack().push_new_table();
+  squip::load_squirrel_table(vm, -1, path);
+  EXPECT_EQ(sq_getsize(vm, -1), 10000);
+  sq_poptop(vm);
+
+  std::filesystem::remove(path);
+}
+
+TEST(SquipSerialize, errors)
+{
+  squip::SquirrelVM sqvm;
+  HSQUIRRELVM vm = sqvm.get_vm();
+
+  sq_newtable(vm);
+  sq_pushstring(vm, "self", -1);
+  sq_push(vm, -2);
+  sq_newslot(vm, -3, SQFalse);
+
+  std::vector<std::byte> data;
+  EXPECT_THROW(squip::save_squirrel_table(vm, -1, data), std::runtime_error);
+  ASSERT_EQ(sq_gettop(vm), 1);
+  EXPECT_TRUE(data.empty());
+
+  std::ostringstream cyclic_out;
+  EXPECT_THROW(squip::save_squirrel_table(vm, -1, cyclic_out), std::runtime_error);
+  ASSERT_EQ(sq_gettop(vm), 1);
+
+  sq_pushstring(vm, "self", -1);
+  sq_deleteslot(vm, -2, SQFalse);
+  sq_pushstring(vm, "value", -1);
+  sq_pushinteger(vm, 42);
+  sq_newslot(vm, -3, SQFalse);
+
+  data.clear();
+  squip::save_squirrel_table(vm, -1, data);
+
+  std::ostringstream out;
+  squip::save_squirrel_table(vm, -1, out);
+  EXPECT_EQ(out.str().size(), data.size());
+
+  // every truncation of valid data must be rejected
+  for (size_t i = 0; i < data.size(); ++i) {
+    EXPECT_THROW(squip::load_squirrel_table(vm, -1, std::span<std::byte const>(data.data(), i)),
+                 std::runtime_error);
+    EXPECT_EQ(sq_gettop(vm), 1);
+  }
+
+  sq_poptop(vm);
+}
+
+/* EOF */
@@ -0,0 +1,173 @@
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <squip/snapshot.hpp>
+#include <squip/squirrel_vm.hpp>
+#include <squip/table_context.hpp>
+#include <squip/util.hpp>
+
+namespace {
+
+SQInteger native_add(HSQUIRRELVM vm)
+{
+  auto [a, b] = squip::unpack_args<SQInteger, SQInteger>(vm);
+  sq_pushinteger(vm, a + b);
+  return 1;
+}
+
+} // namespace
+
+TEST(SquipSnapshot, save_and_load)
+{
+  std::filesystem::path const path = std::filesystem::temp_directory_path() / "squip_snapshot_test.sqs";
+
+  {
+    squip::SquirrelVM sqvm;
+    HSQUIRRELVM vm = sqvm.get_vm();
+
+    {
+      squip::TableContext root = sqvm.stack().push_roottable();
+      root.store_c_function("native_add", ".ii", &native_add);
+      sq_poptop(vm);
+    }
+
+    squip::compile_and_run(vm,
+                           "class Base { name = \"base\"; function get_name() { return name; } }"
+                           "class Derived extends Base { value = 0; static count = 3; function get_value() { return value * 2; } }"
+                           "g_shared <- { text = \"shared\" };"
+                           "g_state <- { a = g_shared, b = g_shared, list = [1, 2.5, \"three\", null, true] };"
+                           "g_state.self <- g_state;"
+                           "g_instance <- Derived();"
+                           "g_instance.value = 21;"
+                           "g_instance.name = \"instance\";"
+                           "g_add <- native_add;"
+                           "function add_twice(x) { return native_add(x, x); }",
+                           "<init>");
+
+    squip::save_snapshot(vm, path);
+  }
+
+  squip::SquirrelVM sqvm;
+  HSQUIRRELVM vm = sqvm.get_vm();
+
+  squip::NativeRegistry registry;
+  registry.add("native_add", ".ii", &native_add);
+  {
+    squip::TableContext root = sqvm.stack().push_roottable();
+    registry.add_table(vm, -1);
+    sq_poptop(vm);
+  }
+
+  squip::load_snapshot(vm, path, registry);
+  ASSERT_EQ(sq_gettop(vm), 0);
+  std::filesystem::remove(path);
+
+  squip::compile_and_run(vm,
+                         "r_shared <- g_state.a == g_state.b;"
+                         "r_self <- g_state.self == g_state;"
+                         "r_list <- g_state.list[2] + g_state.list[1];"
+                         "r_value <- g_instance.get_value();"
+                         "r_name <- g_instance.get_name();"
+                         "r_instanceof <- g_instance instanceof Base;"
+                         "r_static <- Derived.count;"
+                         "r_new <- Derived().get_name();"
+                         "r_add <- g_add(1, 2) + add_twice(5);",
+                         "<check>");
+
+  squip::TableContext root = sqvm.stack().push_roottable();
+  EXPECT_TRUE(root.get<bool>("r_shared"));
+  EXPECT_TRUE(root.get<bool>("r_self"));
+  EXPECT_EQ(root.get<std::string>("r_list"), "three2.5");
+  EXPECT_EQ(root.get<SQInteger>("r_value"), 42);
+  EXPECT_EQ(root.get<std::string>("r_name"), "instance");
+  EXPECT_TRUE(root.get<bool>("r_instanceof"));
+  EXPECT_EQ(root.get<SQInteger>("r_static"), 3);
+  EXPECT_EQ(root.get<std::string>("r_new"), "base");
+  EXPECT_EQ(root.get<SQInteger>("r_add"), 13);
+  sq_poptop(vm);
+}
+
+TEST(SquipSnapshot, errors)
+{
+  std::vector<std::byte> data;
+
+  {
+    squip::SquirrelVM sqvm;
+    HSQUIRRELVM vm = sqvm.get_vm();
+
+    {
+      squip::TableContext root = sqvm.stack().push_roottable();
+      root.store_c_function("native_add", ".ii", &native_add);
+      sq_poptop(vm);
+    }
+
+    squip::save_snapshot(vm, data);
+    ASSERT_EQ(sq_gettop(vm), 0);
+  }
+
+  squip::SquirrelVM sqvm;
+  HSQUIRRELVM vm = sqvm.get_vm();
+
+  // natives can't be resolved without a registry
+  squip::NativeRegistry registry;
+  EXPECT_THROW(squip::load_snapshot(vm, data, registry), std::runtime_error);
+  ASSERT_EQ(sq_gettop(vm), 0);
+
+  std::vector<std::byte> const truncated(data.begin(), data.begin() + 10);
+  EXPECT_THROW(squip::load_snapshot(vm, truncated, registry), std::runtime_error);
+  ASSERT_EQ(sq_gettop(vm), 0);
+}
+
+TEST(SquipSnapshot, metamethods_are_dropped)
+{
+  std::vector<std::byte> data;
+
+  {
+    squip::SquirrelVM sqvm;
+    HSQUIRRELVM vm = sqvm.get_vm();
+
+    squip::compile_and_run(vm,
+                           "class Version {"
+                           "  major = 0;"
+                           "  constructor(m) { major = m; }"
+                           "  function get_major() { return major; }"
+                           "  function _tostring() { return \"v\" + major; }"
+                           "}"
+                           "g_version <- Version(2);",
+                           "<init>");
+
+    squip::save_snapshot(vm, data);
+    ASSERT_EQ(sq_gettop(vm), 0);
+  }
+
+  squip::SquirrelVM sqvm;
+  HSQUIRRELVM vm = sqvm.get_vm();
+
+  squip::NativeRegistry registry;
+  {
+    squip::TableContext root = sqvm.stack().push_roottable();
+    registry.add_table(vm, -1);
+    sq_poptop(vm);
+  }
+
+  squip::load_snapshot(vm, data, registry);
+  ASSERT_EQ(sq_gettop(vm), 0);
+
+  squip::compile_and_run(vm,
+                         "r_major <- g_version.get_major();"
+                         "r_tostring <- g_version.tostring();",
+                         "<check>");
+
+  // fields and methods survive, _tostring does not
+  squip::TableContext root = sqvm.stack().push_roottable();
+  EXPECT_EQ(root.get<SQInteger>("r_major"), 2);
+  EXPECT_NE(root.get<std::string>("r_tostring"), "v2");
+  sq_poptop(vm);
+}
+
+/* EOF */
@@ -126,4 +126,23 @@ TEST(SquipSquirrelVM, thread)
             "19 +++ Thread2: 9\n");
 }
 
+TEST(SquipSquirrelVM, from_vm)
+{
+  squip::SquirrelVM sqvm;
+  EXPECT_EQ(squip::SquirrelVM::from_vm(sqvm.get_vm()), &sqvm);
+
+  HSQUIRRELVM thread = sq_newthread(sqvm.get_vm(), 64);
+  EXPECT_EQ(squip::SquirrelVM::from_vm(thread), &sqvm);
+  sq_poptop(sqvm.get_vm());
+
+  // VMs not created through SquirrelVM may use the pointer for their own data
+  int foreign_data = 0;
+  HSQUIRRELVM vm = sq_open(64);
+  sq_setsharedforeignptr(vm, &foreign_data);
+  EXPECT_EQ(squip::SquirrelVM::from_vm(vm), nullptr);
+  sq_setsharedforeignptr(vm, nullptr);
+  EXPECT_EQ(squip::SquirrelVM::from_vm(vm), nullptr);
+  sq_close(vm);
+}
+
 /* EOF */
@@ -1,6 +1,11 @@
 #include <gtest/gtest.h>
 
 #include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
 #include <squip/util.hpp>
 #include <squip/squirrel_vm.hpp>
 
@@ -75,4 +80,25 @@ TEST(SquipTableContext, store)
   sq_poptop(sqvm.get_vm());
 }
 
+TEST(SquipTableContext, try_get)
+{
+  squip::SquirrelVM sqvm;
+  HSQUIRRELVM vm = sqvm.get_vm();
+
+  squip::TableContext table = sqvm.stack().push_new_table();
+  table.store("intvalue", 45);
+  table.store("stringvalue", "StringValue");
+
+  EXPECT_EQ(table.try_get<int>("intvalue"), 45);
+  EXPECT_EQ(table.try_get<std::string>("stringvalue"), "StringValue");
+  EXPECT_EQ(table.try_get<int>("missing"), std::nullopt);
+  EXPECT_EQ(table.try_get<int>("stringvalue"), std::nullopt);
+  EXPECT_EQ(table.try_get<std::vector<SQInteger>>("intvalue"), std::nullopt);
+  ASSERT_EQ(sq_gettop(vm), 1);
+
+  EXPECT_EQ(sqvm.stack().try_get<std::string_view>(-1), std::nullopt);
+  sq_poptop(vm);
+  ASSERT_EQ(sq_gettop(vm), 0);
+}
+
 /* EOF */
@@ -1,10 +1,14 @@
 #include <gtest/gtest.h>
 
+#include <array>
+#include <span>
 #include <sstream>
+#include <string_view>
 #include <vector>
 
 #include <fmt/format.h>
 
+#include <squip/squirrel_error.hpp>
 #include <squip/squirrel_vm.hpp>
 #include <squip/unpack.hpp>
 #include <squip/util.hpp>
@@ -49,6 +53,65 @@ TEST(SquipUnpack, unpack)
   sq_pop(vm, 6);
 }
 
+TEST(SquipUnpack, unpack_string_view)
+{
+  squip::SquirrelVM sqvm;
+  HSQUIRRELVM vm = sqvm.get_vm();
+
+  sq_pushroottable(vm);
+  sq_pushstring(vm, "Hello\0World", 11);
+  sq_pushinteger(vm, 5);
+
+  std::string_view const view = squip::unpack<std::string_view>(vm, 2);
+  EXPECT_EQ(view, std::string_view("Hello\0World", 11));
+  EXPECT_THROW(squip::unpack<std::string_view>(vm, 3), squip::SquirrelError);
+
+  auto [str, num] = squip::unpack_args<std::string_view, SQInteger>(vm);
+  EXPECT_EQ(str.data(), view.data());
+  EXPECT_EQ(num, 5);
+
+  sq_pop(vm, 3);
+}
+
+TEST(SquipUnpack, unpack_array)
+{
+  squip::SquirrelVM sqvm;
+  HSQUIRRELVM vm = sqvm.get_vm();
+
+  sq_newarray(vm, 1000);
+  for (SQInteger i = 0; i < 1000; ++i) {
+    sq_pushinteger(vm, i);
+    sq_pushfloat(vm, static_cast<SQFloat>(i) * 0.5f);
+    ASSERT_TRUE(SQ_SUCCEEDED(sq_set(vm, -3)));
+  }
+
+  std::vector<SQFloat> values = squip::unpack_array<SQFloat>(vm, -1);
+  ASSERT_EQ(values.size(), 1000u);
+  EXPECT_EQ(values[0], 0.0f);
+  EXPECT_EQ(values[999], 499.5f);
+  ASSERT_EQ(sq_gettop(vm), 1);
+
+  std::array<SQFloat, 1024> buffer{};
+  EXPECT_EQ(squip::unpack_into(vm, -1, std::span<SQFloat>(buffer)), 1000u);
+  EXPECT_EQ(buffer[1], 0.5f);
+  EXPECT_EQ(buffer[999], 499.5f);
+  EXPECT_EQ(buffer[1000], 0.0f);
+  ASSERT_EQ(sq_gettop(vm), 1);
+
+  std::array<SQFloat, 10> small_buffer{};
+  EXPECT_THROW(squip::unpack_into(vm, -1, std::span<SQFloat>(small_buffer)), squip::SquirrelError);
+
+  // an element that can't be converted must not be left on the stack
+  sq_pushinteger(vm, 500);
+  sq_pushstring(vm, "not a number", -1);
+  ASSERT_TRUE(SQ_SUCCEEDED(sq_set(vm, -3)));
+  EXPECT_THROW(squip::unpack_into(vm, -1, std::span<SQFloat>(buffer)), squip::SquirrelError);
+  ASSERT_EQ(sq_gettop(vm), 1);
+
+  sq_poptop(vm);
+  ASSERT_EQ(sq_gettop(vm), 0);
+}
+
 /* EOF */
 
 
@@ -1,11 +1,19 @@
 #include <gtest/gtest.h>
 
+#include <array>
+#include <cstddef>
+#include <map>
+#include <span>
 #include <sstream>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <fmt/format.h>
 
 #include <squip/squirrel_vm.hpp>
+#include <squip/table_context.hpp>
+#include <squip/unpack.hpp>
 #include <squip/util.hpp>
 
 TEST(SquipUtil, print_stack)
@@ -226,6 +234,44 @@ TEST(SquipUtil, print)
   ASSERT_EQ(sq_gettop(vm), 0);
 }
 
+TEST(SquipUtil, repr_buffer)
+{
+  squip::SquirrelVM sqvm;
+  HSQUIRRELVM vm = sqvm.get_vm();
+
+  fmt::memory_buffer out;
+
+  sq_pushstring(vm, "plain \"quoted\"\ttab\0nul", 22);
+  squip::repr(vm, -1, out);
+  EXPECT_EQ(fmt::to_string(out), "\"plain \\\"quoted\\\"\\ttab\\0nul\"");
+  sq_poptop(vm);
+
+  // appends to the existing content
+  sq_pushfloat(vm, 0.1f);
+  out.push_back(' ');
+  squip::print(vm, -1, out);
+  EXPECT_TRUE(fmt::to_string(out).ends_with(" 0.1"));
+  sq_poptop(vm);
+
+  out.clear();
+  sq_pushinteger(vm, -1234567890123);
+  squip::repr(vm, -1, out);
+  EXPECT_EQ(fmt::to_string(out), "-1234567890123");
+  sq_poptop(vm);
+
+  squip::compile_and_run(vm, "g_value <- { list = [1, 2.5, \"three\"] };", "<source>");
+  out.clear();
+  sq_pushroottable(vm);
+  sq_pushstring(vm, "g_value", -1);
+  sq_get(vm, -2);
+  squip::repr(vm, -1, out, true);
+  EXPECT_EQ(fmt::to_string(out), "{\n  \"list\": [1, 2.5, \"three\"]\n}");
+  EXPECT_EQ(squip::to_repr(vm, -1), "{\"list\": [1, 2.5, \"three\"]}");
+  sq_pop(vm, 2);
+
+  ASSERT_EQ(sq_gettop(vm), 0);
+}
+
 TEST(SquipUtil, store_function)
 {
   squip::SquirrelVM sqvm;
@@ -244,6 +290,79 @@ TEST(SquipUtil, store_function)
   ASSERT_EQ(sq_gettop(vm), 0);
 }
 
+TEST(SquipUtil, push_closure)
+{
+  int destroyed = 0;
+  {
+    squip::SquirrelVM sqvm;
+    HSQUIRRELVM vm = sqvm.get_vm();
+
+    struct Tracker {
+      int* counter;
+      Tracker(int* counter_) : counter(counter_) {}
+      Tracker(Tracker&& other) noexcept : counter(other.counter) { other.counter = nullptr; }
+      ~Tracker() { if (counter) { *counter += 1; } }
+      Tracker(const Tracker&) = delete;
+      Tracker& operator=(const Tracker&) = delete;
+      Tracker& operator=(Tracker&&) = delete;
+    };
+
+    std::array<SQInteger, 32> values{};
+    values[31] = 42;
+    squip::push_closure(vm, [values, tracker = Tracker(&destroyed)](HSQUIRRELVM lvm) -> SQInteger {
+      sq_pushinteger(lvm, values[31]);
+      return 1;
+    });
+
+    sq_pushroottable(vm);
+    ASSERT_TRUE(SQ_SUCCEEDED(sq_call(vm, 1, SQTrue, SQFalse)));
+    EXPECT_EQ(squip::unpack<SQInteger>(vm, -1), 42);
+    sq_pop(vm, 2);
+    ASSERT_EQ(sq_gettop(vm), 0);
+    EXPECT_EQ(destroyed, 0);
+  }
+  EXPECT_EQ(destroyed, 1);
+}
+
+TEST(SquipUtil, push_value_containers)
+{
+  squip::SquirrelVM sqvm;
+  HSQUIRRELVM vm = sqvm.get_vm();
+
+  squip::push_value(vm, std::vector<int>{11, 22, 33});
+  EXPECT_EQ(sq_getsize(vm, -1), 3);
+  EXPECT_EQ(squip::unpack<std::vector<SQInteger>>(vm, -1), (std::vector<SQInteger>{11, 22, 33}));
+  sq_poptop(vm);
+
+  std::array<SQFloat, 3> floats{0.5f, 1.5f, 2.5f};
+  squip::push_value(vm, std::span<SQFloat const>(floats));
+  EXPECT_EQ(squip::unpack<std::vector<SQFloat>>(vm, -1), (std::vector<SQFloat>{0.5f, 1.5f, 2.5f}));
+  sq_poptop(vm);
+
+  squip::push_value(vm, std::vector<std::vector<int>>{{1, 2}, {3}});
+  EXPECT_EQ(squip::to_repr(vm, -1), "[[1, 2], [3]]");
+  sq_poptop(vm);
+
+  squip::push_value(vm, std::map<std::string, int>{{"a", 1}, {"b", 2}});
+  {
+    squip::TableContext table(vm, -1);
+    EXPECT_EQ(sq_getsize(vm, -1), 2);
+    EXPECT_EQ(table.get<int>("a"), 1);
+    EXPECT_EQ(table.get<int>("b"), 2);
+  }
+  sq_poptop(vm);
+
+  squip::push_value(vm, std::unordered_map<std::string, std::vector<int>>{{"list", {4, 5}}});
+  {
+    squip::TableContext table(vm, -1);
+    EXPECT_EQ(sq_getsize(vm, -1), 1);
+    EXPECT_EQ(table.get<std::vector<SQInteger>>("list"), (std::vector<SQInteger>{4, 5}));
+  }
+  sq_poptop(vm);
+
+  ASSERT_EQ(sq_gettop(vm), 0);
+}
+
 TEST(SquipUtil, readwrite_closure)
 {
   squip::SquirrelVM sqvm;
@@ -280,4 +399,82 @@ TEST(SquipUtil, readwrite_closure)
   ASSERT_EQ(sq_gettop(vm), 0);
 }
 
+TEST(SquipUtil, readwrite_closure_buffer)
+{
+  squip::SquirrelVM sqvm;
+  HSQUIRRELVM vm = sqvm.get_vm();
+
+  std::ostringstream out;
+  sqvm.set_printfunc(
+    [&out](char const* msg){
+      out << msg;
+    },
+    [&out](char const* msg){
+      out << msg;
+    });
+
+  std::vector<std::byte> bytecode;
+  squip::compile_buffer(vm, "print(\"Hello\")", "<source1>");
+  squip::write_closure(vm, bytecode);
+  sq_poptop(vm);
+  size_t const first_size = bytecode.size();
+
+  squip::compile_buffer(vm, "print(\"World\\n\")", "<source2>");
+  squip::write_closure(vm, bytecode);
+  sq_poptop(vm);
+  ASSERT_EQ(sq_gettop(vm), 0);
+
+  std::span<std::byte const> data = bytecode;
+  size_t const consumed = squip::read_closure(vm, data);
+  EXPECT_EQ(consumed, first_size);
+  squip::run_closure(vm, "<source1>");
+
+  EXPECT_EQ(squip::read_closure(vm, data.subspan(consumed)), bytecode.size() - first_size);
+  squip::run_closure(vm, "<source2>");
+
+  ASSERT_EQ(out.str(), "HelloWorld\n");
+  ASSERT_EQ(sq_gettop(vm), 0);
+
+  EXPECT_THROW(squip::read_closure(vm, data.first(first_size / 2)), squip::SquirrelError);
+  ASSERT_EQ(sq_gettop(vm), 0);
+}
+
+TEST(SquipUtil, compile_buffer)
+{
+  squip::SquirrelVM sqvm;
+  HSQUIRRELVM vm = sqvm.get_vm();
+
+  std::string_view const source = "g_value <- 11 + 22; g_trailing <- 5; garbage that is not compiled";
+  squip::compile_buffer(vm, source.substr(0, source.find("garbage")), "<source>");
+  ASSERT_EQ(sq_gettype(vm, -1), OT_CLOSURE);
+  sq_pushroottable(vm);
+  ASSERT_TRUE(SQ_SUCCEEDED(sq_call(vm, 1, SQFalse, SQTrue)));
+  sq_poptop(vm);
+  ASSERT_EQ(sq_gettop(vm), 0);
+
+  squip::compile_and_run(vm, std::string_view("g_value += g_trailing"), "<source>");
+  ASSERT_EQ(sq_gettop(vm), 0);
+
+  squip::TableContext root = sqvm.stack().push_roottable();
+  EXPECT_EQ(root.get<int>("g_value"), 38);
+  sq_poptop(vm);
+
+  EXPECT_THROW(squip::compile_buffer(vm, "a +", "<source>"), squip::SquirrelError);
+  ASSERT_EQ(sq_gettop(vm), 0);
+}
+
+TEST(SquipUtil, compile_file)
+{
+  squip::SquirrelVM sqvm;
+  HSQUIRRELVM vm = sqvm.get_vm();
+
+  squip::compile_file(vm, "tests/thread1.nut");
+  ASSERT_EQ(sq_gettype(vm, -1), OT_CLOSURE);
+  sq_poptop(vm);
+  ASSERT_EQ(sq_gettop(vm), 0);
+
+  EXPECT_THROW(squip::compile_file(vm, "tests/does_not_exist.nut"), std::runtime_error);
+  ASSERT_EQ(sq_gettop(vm), 0);
+}
+
 /* EOF */
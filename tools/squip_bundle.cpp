@@ -0,0 +1,125 @@
+// squip - Utilities for Squirrel
+// Copyright (C) 2023 Ingo Ruhnke <grumbel@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <squip/bundle.hpp>
+#include <squip/precompile.hpp>
+
+namespace {
+
+struct Options
+{
+  std::filesystem::path output = {};
+  std::filesystem::path root = {};
+  std::vector<std::filesystem::path> files = {};
+};
+
+void print_usage(char const* arg0)
+{
+  std::cout << "Usage: " << arg0 << " -o OUTPUT [OPTION]... FILE...\n"
+            << "Compile Squirrel scripts and pack them into a bundle\n"
+            << "\n"
+            << "Options:\n"
+            << "  -o, --output FILE  Write the bundle to FILE\n"
+            << "  -r, --root DIR     Name entries relative to DIR\n"
+            << "  -h, --help         Display this help text\n";
+}
+
+Options parse_args(int argc, char** argv)
+{
+  Options opts;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (argv[i][0] == '-')
+    {
+      if (strcmp(argv[i], "-o") == 0 ||
+          strcmp(argv[i], "--output") == 0)
+      {
+        i += 1;
+        if (i >= argc) {
+          throw std::runtime_error(fmt::format("'{}' requires an argument", argv[i - 1]));
+        }
+
+        opts.output = argv[i];
+      }
+      else if (strcmp(argv[i], "-r") == 0 ||
+               strcmp(argv[i], "--root") == 0)
+      {
+        i += 1;
+        if (i >= argc) {
+          throw std::runtime_error(fmt::format("'{}' requires an argument", argv[i - 1]));
+        }
+
+        opts.root = argv[i];
+      }
+      else if (strcmp(argv[i], "-h") == 0 ||
+               strcmp(argv[i], "--help") == 0)
+      {
+        print_usage(argv[0]);
+        exit(EXIT_SUCCESS);
+      }
+      else
+      {
+        throw std::runtime_error(fmt::format("unknown option: '{}'", argv[i]));
+      }
+    }
+    else // rest arguments
+    {
+      opts.files.emplace_back(argv[i]);
+    }
+  }
+
+  if (opts.output.empty()) {
+    throw std::runtime_error("no output file given, use '--output FILE'");
+  }
+
+  return opts;
+}
+
+} // namespace
+
+int main(int argc, char** argv) try
+{
+  Options const opts = parse_args(argc, argv);
+
+  std::vector<std::vector<std::byte>> bytecodes = squip::precompile_files(opts.files);
+
+  squip::BundleWriter writer;
+  for (size_t i = 0; i < opts.files.size(); ++i) {
+    std::filesystem::path const& file = opts.files[i];
+    std::filesystem::path const name = opts.root.empty() ? file : file.lexically_relative(opts.root);
+    writer.add_bytecode(name.generic_string(), std::move(bytecodes[i]));
+  }
+
+  writer.write(opts.output);
+
+  return EXIT_SUCCESS;
+}
+catch (std::exception const& err) {
+  std::cerr << "error: " << err.what() << std::endl;
+  return EXIT_FAILURE;
+}
+
+/* EOF */